@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) Massachusetts Institute of Technology
+ *
+ * See LICENSE in top-level directory
+ */
+#include "autotune.hpp"
+
+#include <cstdio>
+#include <limits>
+
+using std::string;
+using std::vector;
+
+namespace H3LPR {
+
+/**
+ * @brief creates an autotuner, the tunables must then be declared using @ref Tunable
+ *
+ * @param parser the parser giving the initial value of the tunables
+ * @param prof the profiler measuring the block
+ * @param block the name or the path of the block used as objective (see Profiler::GetCost)
+ * @param n_sample the number of steps measured for every configuration
+ * @param n_sweep the max number of sweeps over the parameters
+ */
+Autotuner::Autotuner(Parser* parser, Profiler* prof, const string& block, const int n_sample, const int n_sweep)
+    : parser_(parser), prof_(prof), block_(block), n_sample_(m_max(n_sample, 1)), n_sweep_(m_max(n_sweep, 1)) {
+    //--------------------------------------------------------------------------
+    m_assert_h3lpr(parser != nullptr && prof != nullptr, "the parser and the profiler cannot be null");
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief returns the cost of the best configuration evaluated so far, the max double if none
+ */
+double Autotuner::best_cost() const {
+    const auto it = cost_.find(best_);
+    return (it != cost_.end()) ? it->second : std::numeric_limits<double>::max();
+}
+
+/**
+ * @brief measures the cost of the current configuration since the last call and moves to the next configuration if needed
+ *
+ * To be called at a safe point, typically at the end of a time-step, outside of the block.
+ * Once the search is over, the best configuration is used and the call returns false.
+ *
+ * @warning this call is collective on MPI_COMM_WORLD
+ *
+ * @return true if the configuration has changed: the tunables must be read again using @ref GetValue
+ */
+bool Autotuner::Step() {
+    //--------------------------------------------------------------------------
+    // get the cost of the block since the last step, the same on every rank
+    const double local_cost = (cost_fun_) ? cost_fun_() : prof_->GetCost(block_);
+    prof_->ResetCost(block_);
+    if (is_done_ || param_.empty()) {
+        return false;
+    }
+    double cost;
+    MPI_Allreduce(&local_cost, &cost, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+    // the first step measures the initial configuration
+    if (!is_started_) {
+        is_started_  = true;
+        isample_     = 0;
+        sample_cost_ = std::numeric_limits<double>::max();
+        iparam_      = 0;
+        icandidate_  = -1;
+        isweep_      = 0;
+        has_changed_ = false;
+    }
+
+    // keep the min over the samples
+    sample_cost_ = m_min(sample_cost_, cost);
+    isample_ += 1;
+    if (isample_ < n_sample_) {
+        return false;
+    }
+
+    // the configuration is evaluated, update the best one
+    const double best = best_cost();
+    cost_[current_]   = sample_cost_;
+    Disp_("evaluated", current_, sample_cost_);
+    if (sample_cost_ < best) {
+        has_changed_ = has_changed_ || (best_ != current_);
+        best_        = current_;
+    }
+    isample_     = 0;
+    sample_cost_ = std::numeric_limits<double>::max();
+
+    // get the next configuration
+    return Next_();
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief moves to the next configuration that has not been evaluated yet, or to the best one if the search is over
+ *
+ * @return true if the configuration has changed
+ */
+bool Autotuner::Next_() {
+    //--------------------------------------------------------------------------
+    const vector<int> previous = current_;
+    const int         n_param  = static_cast<int>(param_.size());
+    while (true) {
+        icandidate_ += 1;
+        // the parameter is done, go to the next one
+        if (icandidate_ >= static_cast<int>(param_[iparam_].candidates.size())) {
+            icandidate_ = 0;
+            iparam_ += 1;
+            // the sweep is done, stop if nothing has changed
+            if (iparam_ >= n_param) {
+                iparam_ = 0;
+                isweep_ += 1;
+                if (!has_changed_ || isweep_ >= n_sweep_) {
+                    is_done_ = true;
+                    current_ = best_;
+                    Disp_("done, best", best_, best_cost());
+                    return (current_ != previous);
+                }
+                has_changed_ = false;
+            }
+        }
+        // the candidate is taken around the best configuration
+        current_          = best_;
+        current_[iparam_] = icandidate_;
+        if (cost_.find(current_) == cost_.end()) {
+            return (current_ != previous);
+        }
+    }
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief writes the best configuration in a file that can be read using --config=filename
+ *
+ * Only rank 0 writes the file.
+ */
+void Autotuner::Save(const string& filename) const {
+    //--------------------------------------------------------------------------
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rank == 0) {
+        FILE* file = fopen(filename.c_str(), "w");
+        m_assert_h3lpr(file != nullptr, "unable to open the file <%s>", filename.c_str());
+        fprintf(file, "# autotuned configuration, objective = block <%s>\n", block_.c_str());
+        fprintf(file, "# best cost = %e [s] after %ld evaluations%s\n", best_cost(), cost_.size(), (is_done_) ? "" : " (search not over)");
+        for (size_t ip = 0; ip < param_.size(); ++ip) {
+            fprintf(file, "%s=%s\n", param_[ip].key.c_str(), param_[ip].candidates[best_[ip]].c_str());
+        }
+        fclose(file);
+    }
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief logs a configuration
+ */
+void Autotuner::Disp_(const char* msg, const vector<int>& config, const double cost) const {
+    //--------------------------------------------------------------------------
+    string str_config;
+    for (size_t ip = 0; ip < param_.size(); ++ip) {
+        str_config += " " + param_[ip].key + "=" + param_[ip].candidates[config[ip]];
+    }
+    m_log_h3lpr("autotune: %s%s -> %e [s]", msg, str_config.c_str(), cost);
+    //--------------------------------------------------------------------------
+}
+
+};  // namespace H3LPR
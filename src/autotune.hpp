@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) Massachusetts Institute of Technology
+ *
+ * See LICENSE in top-level directory
+ */
+#ifndef H3LPR_SRC_AUTOTUNE_HPP_
+#define H3LPR_SRC_AUTOTUNE_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "macros.hpp"
+#include "parser.hpp"
+#include "profiler.hpp"
+
+namespace H3LPR {
+
+/**
+ * @brief a parameter tuned by the Autotuner
+ */
+struct AutotuneParam {
+    std::string              key;         //!< the key of the parameter, i.e. --block-size
+    std::vector<std::string> candidates;  //!< the possible values, stored as strings
+};
+
+//==============================================================================
+/**
+ * @brief Tunes the parameters declared as tunable using the time spent in a block of the Profiler as objective
+ *
+ * The search is a coordinate descent: for each parameter in turn, every candidate is evaluated while the other
+ * parameters are fixed to their best value, and the best candidate is kept. The sweep over the parameters is repeated
+ * until no parameter changes or the max number of sweeps is reached. A configuration is never evaluated twice.
+ *
+ * The cost of a configuration is the time spent in the block between two calls to @ref Step, reduced using MPI_MAX,
+ * so that every rank takes the same decisions. The minimum over the samples is kept to filter the noise.
+ * Another measurement can be given using @ref SetCost, e.g. a hardware counter or a synthetic cost in the tests.
+ *
+ * @warning @ref Step is collective on MPI_COMM_WORLD and the tunables must be declared in the same order on every rank
+ */
+class Autotuner {
+   protected:
+    Parser*           parser_;   //!< the parser giving the initial value of the tunables
+    Profiler*         prof_;     //!< the profiler measuring the block
+    const std::string block_;    //!< the name or path of the block used as objective
+    const int         n_sample_; //!< number of steps measured for one configuration
+    const int         n_sweep_;  //!< max number of sweeps over the parameters
+
+    std::function<double()> cost_fun_;  //!< the measurement of the cost since the last step, the block time if empty
+
+    std::vector<AutotuneParam> param_;  //!< the tunables
+
+    std::vector<int>                   current_;  //!< the index of the candidate of every tunable currently used
+    std::vector<int>                   best_;     //!< the index of the candidate of every tunable in the best configuration
+    std::map<std::vector<int>, double> cost_;     //!< the cost of the configurations already evaluated
+
+    bool   is_started_  = false;  //!< true once the first configuration is evaluated
+    bool   is_done_     = false;  //!< true once the search is over, the best configuration is used
+    bool   has_changed_ = false;  //!< true if a parameter has changed during the current sweep
+    int    iparam_      = 0;      //!< the parameter currently tuned
+    int    icandidate_  = 0;      //!< the candidate currently evaluated
+    int    isweep_      = 0;      //!< the current sweep
+    int    isample_     = 0;      //!< the number of samples measured for the current configuration
+    double sample_cost_ = 0.0;    //!< the min cost of the samples of the current configuration
+
+   public:
+    explicit Autotuner(Parser* parser, Profiler* prof, const std::string& block, const int n_sample = 1, const int n_sweep = 2);
+
+    bool   is_done() const { return is_done_; }
+    double best_cost() const;
+
+    /**
+     * @brief replaces the time spent in the block by another measurement, called once per @ref Step on every rank
+     */
+    void SetCost(const std::function<double()>& cost_fun) { cost_fun_ = cost_fun; }
+
+    /**
+     * @brief declares a tunable parameter and returns its current value
+     *
+     * The initial value is the one given to the parser if any (added to the candidates if needed),
+     * the first candidate otherwise.
+     *
+     * @param key the key of the parameter, i.e. --block-size
+     * @param doc the documentation of the parameter
+     * @param candidates the possible values
+     */
+    template <typename T>
+    T Tunable(const std::string& key, const std::string& doc, const std::vector<T>& candidates) {
+        //----------------------------------------------------------------------
+        m_assert_h3lpr(!candidates.empty(), "the parameter <%s> needs at least one candidate", key.c_str());
+        m_assert_h3lpr(!is_started_, "the parameter <%s> must be declared before the first step", key.c_str());
+        AutotuneParam param;
+        param.key = key;
+        for (const T& candidate : candidates) {
+            param.candidates.push_back(convertTypeToStr<T>(candidate));
+        }
+        // the initial value given by the user is the starting point
+        const std::string initval = convertTypeToStr<T>(parser_->GetValue<T>(key, doc + " (tunable)", candidates[0]));
+        const auto        it      = std::find(param.candidates.begin(), param.candidates.end(), initval);
+        int               index   = static_cast<int>(it - param.candidates.begin());
+        if (it == param.candidates.end()) {
+            param.candidates.insert(param.candidates.begin(), initval);
+            index = 0;
+        }
+        param_.push_back(param);
+        current_.push_back(index);
+        best_.push_back(index);
+        return GetValue<T>(key);
+        //----------------------------------------------------------------------
+    }
+
+    /**
+     * @brief declares a tunable parameter with candidates in [min, max], every step, see @ref Tunable
+     */
+    template <typename T>
+    T TunableRange(const std::string& key, const std::string& doc, const T min, const T max, const T step) {
+        //----------------------------------------------------------------------
+        m_assert_h3lpr(step > 0 && min <= max, "the range of the parameter <%s> is invalid", key.c_str());
+        // the candidates are computed from their index, adding the steps would accumulate the rounding errors
+        const long     n_step = static_cast<long>(std::floor(static_cast<double>(max - min) / static_cast<double>(step) * (1.0 + 1e-12)));
+        std::vector<T> candidates;
+        for (long i = 0; i <= n_step; ++i) {
+            candidates.push_back(static_cast<T>(min + static_cast<T>(i) * step));
+        }
+        return Tunable<T>(key, doc, candidates);
+        //----------------------------------------------------------------------
+    }
+
+    /**
+     * @brief returns the value of a tunable parameter in the current configuration
+     */
+    template <typename T>
+    T GetValue(const std::string& key) const {
+        //----------------------------------------------------------------------
+        for (size_t ip = 0; ip < param_.size(); ++ip) {
+            if (param_[ip].key == key) {
+                return convertStrToType<T>(param_[ip].candidates[current_[ip]]);
+            }
+        }
+        m_assert_h3lpr(false, "the parameter <%s> is not tunable", key.c_str());
+        return T();
+        //----------------------------------------------------------------------
+    }
+
+    bool Step();
+    void Save(const std::string& filename) const;
+
+   protected:
+    bool Next_();
+    void Disp_(const char* msg, const std::vector<int>& config, const double cost) const;
+};
+
+};  // namespace H3LPR
+
+#endif  // H3LPR_SRC_AUTOTUNE_HPP_
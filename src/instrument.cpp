@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) Massachusetts Institute of Technology
+ *
+ * See LICENSE in top-level directory
+ */
+#include "instrument.hpp"
+
+#include <cxxabi.h>
+#include <dlfcn.h>  // for dladdr
+
+#include <thread>
+#include <unordered_map>
+
+using std::string;
+using std::vector;
+
+namespace H3LPR {
+
+#if (M_INSTRUMENT_PROF)
+#define M_NO_INSTRUMENT __attribute__((no_instrument_function))
+
+/**
+ * @brief information on an instrumented function, obtained the first time the function is entered
+ */
+struct InstrumentFunction {
+    bool     keep;  //!< true if the function passes the filters
+    string   name;  //!< the demangled name
+    ProfSite site;  //!< the call site used to access the block
+};
+
+/**
+ * @brief state of the instrumentation
+ */
+struct InstrumentState {
+    Profiler*       prof      = nullptr;  //!< the profiler in which the functions are recorded, nullptr if inactive
+    int             max_depth = 0;        //!< max depth of instrumented functions
+    int             depth     = 0;        //!< number of recorded functions in the stack (the filtered ones are not counted)
+    std::thread::id thread;               //!< the only thread that is recorded
+
+    vector<string> include;  //!< the function is kept if its name contains one of these (if not empty)
+    vector<string> exclude;  //!< the function is discarded if its name contains one of these
+
+    vector<InstrumentFunction*>                   stack;     //!< the functions currently entered, nullptr if not recorded
+    std::unordered_map<void*, InstrumentFunction> function;  //!< cache of the functions, by address
+};
+
+static InstrumentState instrument;
+
+/**
+ * @brief returns the information on a function, resolving its name with dladdr and __cxa_demangle the first time only
+ *
+ * Functions are identified by their names and not by their addresses, which differ from one rank to another (ASLR).
+ */
+M_NO_INSTRUMENT static InstrumentFunction* GetFunction(void* fn) {
+    //--------------------------------------------------------------------------
+    auto it = instrument.function.find(fn);
+    if (it != instrument.function.end()) {
+        return &(it->second);
+    }
+
+    // resolve the name
+    string  name;
+    Dl_info info;
+    if (dladdr(fn, &info) != 0 && info.dli_sname != nullptr) {
+        int   status;
+        char* demgled_name = abi::__cxa_demangle(info.dli_sname, NULL, NULL, &status);
+        name               = (status == 0) ? string(demgled_name) : string(info.dli_sname);
+        free(demgled_name);
+    } else {
+        char addr[32];
+        snprintf(addr, 32, "%p", fn);
+        name = addr;
+    }
+
+    // apply the filters
+    bool keep = instrument.include.empty();
+    for (const string& inc : instrument.include) {
+        keep = keep || (name.find(inc) != string::npos);
+    }
+    for (const string& exc : instrument.exclude) {
+        keep = keep && (name.find(exc) == string::npos);
+    }
+
+    // the node of the map is stable, we can point to the name
+    InstrumentFunction* function = &(instrument.function[fn]);
+    function->keep               = keep;
+    function->name               = name;
+    function->site.name          = function->name.c_str();
+    return function;
+    //--------------------------------------------------------------------------
+}
+
+#endif
+
+/**
+ * @brief records the time spent in every function compiled with -finstrument-functions as blocks of the profiler
+ *
+ * The functions are added under the current block, only the calling thread is recorded.
+ * The library must be compiled with -DINSTRUMENT_PROF, otherwise nothing happens.
+ *
+ * @warning the functions called must be the same on every rank to display the profiler
+ *
+ * @param prof the profiler
+ * @param include if not empty, only the functions whose name contains one of the strings are recorded
+ * @param exclude the functions whose name contains one of the strings are not recorded
+ * @param max_depth the max number of nested functions recorded
+ */
+void InstrumentStart([[maybe_unused]] Profiler* prof, [[maybe_unused]] const vector<string>& include, [[maybe_unused]] const vector<string>& exclude, [[maybe_unused]] const int max_depth) {
+    //--------------------------------------------------------------------------
+#if (M_INSTRUMENT_PROF)
+    instrument.prof      = nullptr;
+    instrument.include   = include;
+    instrument.exclude   = exclude;
+    instrument.max_depth = max_depth;
+    instrument.thread    = std::this_thread::get_id();
+    instrument.depth     = 0;
+    instrument.stack.clear();
+    instrument.function.clear();
+    // activate it last
+    instrument.prof = prof;
+#else
+    m_log_h3lpr("WARNING: the instrumentation requires h3lpr to be compiled with -DINSTRUMENT_PROF");
+#endif
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief stops the recording, the functions still running are stopped
+ */
+void InstrumentStop() {
+    //--------------------------------------------------------------------------
+#if (M_INSTRUMENT_PROF)
+    Profiler* prof  = instrument.prof;
+    instrument.prof = nullptr;
+    if (prof != nullptr) {
+        const double wtime = MPI_Wtime();
+        for (auto it = instrument.stack.rbegin(); it != instrument.stack.rend(); ++it) {
+            if (*it != nullptr) {
+                prof->Exit(&((*it)->site), wtime);
+            }
+        }
+    }
+    instrument.depth = 0;
+    instrument.stack.clear();
+#endif
+    //--------------------------------------------------------------------------
+}
+
+};  // namespace H3LPR
+
+#if (M_INSTRUMENT_PROF)
+using H3LPR::instrument;
+
+extern "C" {
+/**
+ * @brief called at the entry of every function compiled with -finstrument-functions
+ */
+M_NO_INSTRUMENT void __cyg_profile_func_enter(void* fn, void*) {
+    if (instrument.prof == nullptr || std::this_thread::get_id() != instrument.thread) {
+        return;
+    }
+    // deactivate the instrumentation while we are in the hook
+    H3LPR::Profiler* prof = instrument.prof;
+    instrument.prof       = nullptr;
+
+    H3LPR::InstrumentFunction* function = H3LPR::GetFunction(fn);
+    if (function->keep && instrument.depth < instrument.max_depth) {
+        prof->Enter(&function->site);
+        instrument.stack.push_back(function);
+        instrument.depth += 1;
+    } else {
+        instrument.stack.push_back(nullptr);
+    }
+    instrument.prof = prof;
+}
+
+/**
+ * @brief called at the exit of every function compiled with -finstrument-functions
+ */
+M_NO_INSTRUMENT void __cyg_profile_func_exit(void*, void*) {
+    const double wtime = MPI_Wtime();
+    // ignore the functions that were entered before the start
+    if (instrument.prof == nullptr || std::this_thread::get_id() != instrument.thread || instrument.stack.empty()) {
+        return;
+    }
+    H3LPR::Profiler* prof = instrument.prof;
+    instrument.prof       = nullptr;
+
+    H3LPR::InstrumentFunction* function = instrument.stack.back();
+    instrument.stack.pop_back();
+    if (function != nullptr) {
+        prof->Exit(&function->site, wtime);
+        instrument.depth -= 1;
+    }
+    instrument.prof = prof;
+}
+}
+#endif
@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) Massachusetts Institute of Technology
+ *
+ * See LICENSE in top-level directory
+ */
+#ifndef H3LPR_SRC_INSTRUMENT_HPP_
+#define H3LPR_SRC_INSTRUMENT_HPP_
+
+#include <string>
+#include <vector>
+
+#include "profiler.hpp"
+
+// enable the hooks of -finstrument-functions
+#ifdef INSTRUMENT_PROF
+#define M_INSTRUMENT_PROF 1
+#else
+#define M_INSTRUMENT_PROF 0
+#endif
+
+namespace H3LPR {
+
+void InstrumentStart(Profiler* prof, const std::vector<std::string>& include = {}, const std::vector<std::string>& exclude = {}, const int max_depth = 16);
+void InstrumentStop();
+
+};  // namespace H3LPR
+
+#endif  // H3LPR_SRC_INSTRUMENT_HPP_
@@ -29,6 +29,67 @@ std::string GetCommit() {
     //--------------------------------------------------------------------------
 }
 
+/**
+ * @brief returns the communicator gathering the ranks of the node (shared memory), created at the first call
+ *
+ * @warning the first call is collective on MPI_COMM_WORLD
+ */
+MPI_Comm NodeComm() {
+    //--------------------------------------------------------------------------
+    static MPI_Comm node_comm = MPI_COMM_NULL;
+    if (node_comm == MPI_COMM_NULL) {
+        MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node_comm);
+    }
+    return node_comm;
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief returns the id of the node, in [0, NodeCount()[, the nodes being ordered as their first rank
+ *
+ * @warning the first call is collective on MPI_COMM_WORLD
+ */
+int NodeId() {
+    //--------------------------------------------------------------------------
+    static int node_id = -1;
+    if (node_id < 0) {
+        MPI_Comm node_comm = NodeComm();
+        int      node_rank;
+        MPI_Comm_rank(node_comm, &node_rank);
+
+        // the id of the node is the rank of its first rank among the first ranks of every node
+        MPI_Comm leader_comm;
+        MPI_Comm_split(MPI_COMM_WORLD, (node_rank == 0) ? 0 : MPI_UNDEFINED, 0, &leader_comm);
+        if (node_rank == 0) {
+            MPI_Comm_rank(leader_comm, &node_id);
+            MPI_Comm_free(&leader_comm);
+        }
+        MPI_Bcast(&node_id, 1, MPI_INT, 0, node_comm);
+    }
+    return node_id;
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief returns the number of nodes
+ *
+ * @warning the first call is collective on MPI_COMM_WORLD
+ */
+int NodeCount() {
+    //--------------------------------------------------------------------------
+    static int node_count = -1;
+    if (node_count < 0) {
+        int node_rank;
+        int is_leader;
+        MPI_Comm_rank(NodeComm(), &node_rank);
+        is_leader = (node_rank == 0);
+        MPI_Allreduce(MPI_IN_PLACE, &is_leader, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+        node_count = is_leader;
+    }
+    return node_count;
+    //--------------------------------------------------------------------------
+}
+
 /**
  * @brief prints the backtrace history
  *
@@ -48,6 +48,10 @@ extern char  m_log_level_prefix[32];
 
 // retun commit id
 std::string GetCommit();
+// node-level information
+MPI_Comm NodeComm();
+int      NodeId();
+int      NodeCount();
 // function used for backtrace logging
 void PrintBackTrace(const char name[]);
 };  // namespace H3LPR
@@ -5,6 +5,9 @@
  */
 #include "parser.hpp"
 
+#include <sys/stat.h>
+#include <unistd.h>
+
 using string = std::string;
 
 namespace H3LPR {
@@ -45,6 +48,12 @@ Parser::Parser(const int argc, const char **argv) : Parser() {
 
     // after having read the input, we must read the file if any
     ParseLogFile_();
+
+    // the lists given as files, before the overrides as the files must be the same on every rank
+    ReadListFiles_();
+
+    // the values given for some ranks or nodes only replace the global ones
+    ResolveOverrides_();
     //--------------------------------------------------------------------------
 }
 
@@ -63,17 +72,22 @@ void Parser::Finalize() {
         std::ostringstream buff;
         buff << "\nPossible parameters and flags for <" << name_ << "> \n";
 
+        // the documentation is grouped by section
+        std::map<string, string> flag_doc;
+        std::map<string, string> arg_doc;
+
         // possible flags
-        buff << "\nflags:\n";
         for (auto it : doc_flag_map_) {
             string key = it.first;
             m_assert_h3lpr(max_flag_length >= key.length(), "the max length = %ld must be bigger than the key length = %ld", max_flag_length, key.length());
             key.append(max_flag_length - key.length() + 3, 0x20);
-            buff << "\t" << key << it.second << "\n";
+            flag_doc[SectionOf_(it.first)] += "\t" + key + it.second + "\n";
+        }
+        for (auto it : flag_doc) {
+            buff << "\nflags" << ((it.first.empty()) ? "" : (" [" + it.first + "]")) << ":\n" << it.second;
         }
 
         // possible arguments
-        buff << "\narguments:\n";
         for (auto it : doc_arg_map_) {
             string key    = it.first;
             string doc    = std::get<0>(it.second);
@@ -85,15 +99,18 @@ void Parser::Finalize() {
             }
             m_assert_h3lpr(max_arg_length >= msg_key.length(), "the max length = %ld must be bigger than the key length = %ld", max_arg_length, key.length());
             msg_key.append(max_arg_length - msg_key.length() + 3, 0x20);
-            buff << "\t" << msg_key << doc << "\n";
+            arg_doc[SectionOf_(key)] += "\t" + msg_key + doc + "\n";
+        }
+        for (auto it : arg_doc) {
+            buff << "\narguments" << ((it.first.empty()) ? "" : (" [" + it.first + "]")) << ":\n" << it.second;
         }
 
-        // list the provided arguments
+        // list the provided arguments, sorted
         buff << "\nprovided:\n";
-        for (auto it : flag_set_) {
+        for (auto it : std::set<string>(flag_set_.begin(), flag_set_.end())) {
             buff << "\t" << it << "\n";
         }
-        for (auto it : arg_map_) {
+        for (auto it : std::map<string, string>(arg_map_.begin(), arg_map_.end())) {
             buff << "\t" << it.first << "=" << it.second << "\n";
         }
 
@@ -103,6 +120,17 @@ void Parser::Finalize() {
     // check if we need to fail (no arguement provided)
     const bool do_fail = flag_set_.find("--error") != flag_set_.end();
     m_assert_h3lpr(!do_fail,"you have failed to provide the required argument, please read the help");
+    is_finalized_ = true;
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief returns the section of a key: `solver.rhs` for `--solver.rhs.tol` and an empty string for `--tol`
+ */
+std::string Parser::SectionOf_(const std::string &key) {
+    //--------------------------------------------------------------------------
+    const size_t dot_pos = key.find_last_of('.');
+    return (dot_pos == string::npos || dot_pos < 2) ? "" : key.substr(2, dot_pos - 2);
     //--------------------------------------------------------------------------
 }
 
@@ -143,7 +171,13 @@ void Parser::ReadArgString_(const std::string &arg_string) {
     }
 
     // check if this arg contains an '=' :
-    const size_t equals_pos = arg_string.find('=');
+    // for an override (--key@rank%4==0=value) the '==' of the selector is skipped
+    size_t equals_pos = arg_string.find('=');
+    if (arg_string.find('@') < equals_pos) {
+        while (equals_pos != string::npos && arg_string.compare(equals_pos, 2, "==") == 0) {
+            equals_pos = arg_string.find('=', equals_pos + 2);
+        }
+    }
 
     if (equals_pos != string::npos) {
         // if we found an equal sign, this is key-value pair
@@ -168,9 +202,197 @@ void Parser::ReadArgString_(const std::string &arg_string) {
     //--------------------------------------------------------------------------
 }
 
+/**
+ * @brief returns the key of an argument: `--key` for `--key=value` or `--key@selector=value`
+ */
+static string KeyOf(const string &arg_string) {
+    return arg_string.substr(0, arg_string.find_first_of("=@"));
+}
+
+/**
+ * @brief returns the modification time of a file, -1 if the file cannot be accessed
+ */
+static double ModifTime(const string &filename) {
+    struct stat file_stat;
+    if (stat(filename.c_str(), &file_stat) != 0) {
+        return -1.0;
+    }
+    return static_cast<double>(file_stat.st_mtim.tv_sec) + 1e-9 * static_cast<double>(file_stat.st_mtim.tv_nsec);
+}
+
+/**
+ * @brief broadcasts a string from rank 0 to every rank of MPI_COMM_WORLD
+ */
+static void BroadcastString(string *str) {
+    long size = static_cast<long>(str->size());
+    MPI_Bcast(&size, 1, MPI_LONG, 0, MPI_COMM_WORLD);
+    str->resize(size);
+    MPI_Bcast(str->data(), size, MPI_CHAR, 0, MPI_COMM_WORLD);
+}
+
+/**
+ * @brief returns true if the selector of an override selects the given rank or node
+ *
+ * @param selector `rank[list]`, `node[list]`, `rank%M==R` or `node%M==R` where list is made of ids and ranges, i.e. `0,2,4-7`
+ * @param rank the rank in MPI_COMM_WORLD
+ * @param node the id of the node, see NodeId()
+ */
+static bool MatchSelector(const string &selector, const int rank, const int node) {
+    //--------------------------------------------------------------------------
+    const bool is_rank = selector.compare(0, 4, "rank") == 0;
+    const bool is_node = selector.compare(0, 4, "node") == 0;
+    m_assert_h3lpr(is_rank || is_node, "the selector <%s> must start with rank or node", selector.c_str());
+    const int    id   = (is_rank) ? rank : node;
+    const string rest = selector.substr(4);
+
+    if (rest.length() > 2 && rest.front() == '[' && rest.back() == ']') {
+        // list of ids and ranges
+        std::istringstream list_ss(rest.substr(1, rest.length() - 2));
+        string             item;
+        while (std::getline(list_ss, item, ',')) {
+            const size_t dash_pos = item.find('-', 1);
+            const int    first    = convertStrToType<int>(item.substr(0, dash_pos));
+            const int    last     = (dash_pos == string::npos) ? first : convertStrToType<int>(item.substr(dash_pos + 1));
+            if (first <= id && id <= last) {
+                return true;
+            }
+        }
+        return false;
+    } else if (rest.length() > 0 && rest.front() == '%') {
+        // modulo
+        const size_t eq_pos = rest.find("==");
+        m_assert_h3lpr(eq_pos != string::npos, "the selector <%s> must be of the form %%M==R", selector.c_str());
+        const int modulo    = convertStrToType<int>(rest.substr(1, eq_pos - 1));
+        const int remainder = convertStrToType<int>(rest.substr(eq_pos + 2));
+        m_assert_h3lpr(modulo > 0, "the modulo of the selector <%s> must be positive", selector.c_str());
+        return (id % modulo) == remainder;
+    }
+    m_assert_h3lpr(false, "unable to read the selector <%s>", selector.c_str());
+    return false;
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief returns the number of ids in [0, n_id[ matched by the selector, the lower the more specific
+ */
+static int SelectorCount(const string &selector, const int n_id) {
+    //--------------------------------------------------------------------------
+    int count = 0;
+    for (int id = 0; id < n_id; ++id) {
+        count += MatchSelector(selector, id, id);
+    }
+    return count;
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief replaces the values by the ones given for the current rank or node: `--key@selector=value`, `--flag@selector`
+ *
+ * The selectors are `rank[0,2,4-7]`, `rank%4==0`, `node[0-3]` or `node%2==1`, see MatchSelector.
+ * A rank override has priority on a node override, which has priority on the value without selector.
+ * Among the overrides of the same kind, the most specific one wins: the one matching the fewest ranks (or nodes).
+ * Two overrides as specific as each other with different values are an error, reported at the Finalize call.
+ * A flag with a selector is set if the selector matches.
+ * The overrides are removed from the list of arguments and flags.
+ *
+ * @warning this call is collective on MPI_COMM_WORLD if a node selector is used
+ */
+void Parser::ResolveOverrides_() {
+    //--------------------------------------------------------------------------
+    // list the overrides
+    std::map<string, string> override_map;
+    bool                     has_node = false;
+    for (auto it = arg_map_.begin(); it != arg_map_.end();) {
+        if (it->first.find('@') != string::npos) {
+            has_node = has_node || (it->first.find("@node") != string::npos);
+            override_map.insert(*it);
+            it = arg_map_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    std::set<string> flag_override_set;
+    for (auto it = flag_set_.begin(); it != flag_set_.end();) {
+        if (it->find('@') != string::npos) {
+            has_node = has_node || (it->find("@node") != string::npos);
+            flag_override_set.insert(*it);
+            it = flag_set_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (override_map.empty() && flag_override_set.empty()) {
+        return;
+    }
+
+    // get the ids and the number of ids
+    int is_mpi;
+    int rank   = 0;
+    int node   = 0;
+    int n_rank = 1;
+    int n_node = 1;
+    MPI_Initialized(&is_mpi);
+    if (is_mpi) {
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        MPI_Comm_size(MPI_COMM_WORLD, &n_rank);
+        node   = (has_node) ? NodeId() : 0;
+        n_node = (has_node) ? NodeCount() : 1;
+    }
+
+    // the flags are set if one of their selectors matches
+    for (const string &flag : flag_override_set) {
+        const size_t at_pos = flag.find('@');
+        if (MatchSelector(flag.substr(at_pos + 1), rank, node)) {
+            m_verb_h3lpr("override %s", flag.substr(0, at_pos).c_str());
+            flag_set_.insert(flag.substr(0, at_pos));
+        }
+    }
+
+    // list the overrides that apply, by key
+    struct Selected {
+        int    priority;
+        int    count;
+        string value;
+    };
+    std::map<string, std::vector<Selected>> selected;
+    for (const auto &it : override_map) {
+        const size_t at_pos   = it.first.find('@');
+        const string key      = it.first.substr(0, at_pos);
+        const string selector = it.first.substr(at_pos + 1);
+        if (!MatchSelector(selector, rank, node)) {
+            continue;
+        }
+        const bool is_rank  = selector.compare(0, 4, "rank") == 0;
+        const int  priority = (is_rank) ? 2 : 1;
+        selected[key].push_back(Selected{priority, SelectorCount(selector, (is_rank) ? n_rank : n_node), it.second});
+    }
+    // keep the one with the highest priority then the most specific one, only a tie with the winner is a conflict
+    for (const auto &it : selected) {
+        const Selected *best = &it.second.front();
+        for (const Selected &sel : it.second) {
+            if (sel.priority > best->priority || (sel.priority == best->priority && sel.count < best->count)) {
+                best = &sel;
+            }
+        }
+        for (const Selected &sel : it.second) {
+            if (sel.priority == best->priority && sel.count == best->count && sel.value != best->value) {
+                m_log_h3lpr("ERROR: rank %d: the overrides of <%s> are as specific as each other and conflict (%s vs %s)", rank, it.first.c_str(), best->value.c_str(), sel.value.c_str());
+                ForceError();
+                break;
+            }
+        }
+        m_verb_h3lpr("override %s = %s", it.first.c_str(), best->value.c_str());
+        arg_map_[it.first] = best->value;
+    }
+    //--------------------------------------------------------------------------
+}
+
 /**
  * @brief try to parse the log file if needed
  *
+ * The file is read and cleaned by the rank 0 only, the cleaned content is then broadcasted to the other ranks.
+ * The number of accesses to the filesystem is therefore independent of the number of ranks.
+ * If MPI is not initialized, the file is read locally.
  */
 void Parser::ParseLogFile_() {
     //--------------------------------------------------------------------------
@@ -178,29 +400,265 @@ void Parser::ParseLogFile_() {
     const auto it      = arg_map_.find("--config");
     const bool do_read = it != arg_map_.end();
 
-    // all the cpus will read the file together
     if (do_read) {
-        const string filename = it->second;
-        // open file
-        std::ifstream input_fs(filename.c_str());
-        m_assert_h3lpr(input_fs.is_open(), "Could not open configuration file <%s>", filename.c_str());
-
-        // remove extraneous whitespace and comments
-        std::stringstream clean_ss;
-        std::string       file_line_str;
-
-        while (std::getline(input_fs, file_line_str)) {
-            std::string::size_type eol = file_line_str.find('#');
-            if (eol != std::string::npos) {
-                file_line_str.erase(eol);
-            }
-            clean_ss << file_line_str << ' ';
+        int is_mpi;
+        int rank = 0;
+        MPI_Initialized(&is_mpi);
+        if (is_mpi) {
+            MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        }
+
+        // only the master reads the file and the included ones
+        string clean_str;
+        if (rank == 0) {
+            ReadConfigFile_(it->second, "", 0, &clean_str);
+        }
+
+        // send the cleaned content to everybody
+        if (is_mpi) {
+            BroadcastString(&clean_str);
         }
 
         // parse clean string
-        std::string arg_string;
+        std::istringstream clean_ss(clean_str);
+        std::string        arg_string;
         while (clean_ss >> arg_string) {
             ReadArgString_(arg_string);
+            file_key_set_.insert(KeyOf(arg_string));
+        }
+    }
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief reloads the configuration file if it has changed and updates the values of the reloadable arguments
+ *
+ * The rank 0 checks the modification time of the configuration file and of the included ones.
+ * If one of them has changed, the files are read again by the rank 0 and broadcasted.
+ * Only the arguments and flags marked as reloadable (see @ref MarkReloadable) are updated, the other changes are ignored.
+ * A reloadable argument removed from the file is removed (its default value is then used).
+ * If one of the files cannot be read (i.e. while it is being replaced), nothing is reloaded until the next call.
+ *
+ * To be called at a safe point, i.e. between two time-steps.
+ *
+ * @warning this call is collective on MPI_COMM_WORLD
+ *
+ * @return true if the value of a reloadable argument or flag has changed
+ */
+bool Parser::Sync() {
+    //--------------------------------------------------------------------------
+    const auto it = arg_map_.find("--config");
+    if (it == arg_map_.end()) {
+        return false;
+    }
+    int is_mpi;
+    int rank = 0;
+    MPI_Initialized(&is_mpi);
+    if (is_mpi) {
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    }
+
+    // the master checks the modification times and reads the files if needed
+    int    has_changed = 0;
+    string clean_str;
+    if (rank == 0) {
+        // a file that cannot be read is probably being written: wait for the next call, keep the old times
+        bool is_readable = true;
+        for (const auto &file : config_file_) {
+            const double mtime = ModifTime(file.first);
+            if (mtime < 0.0 || access(file.first.c_str(), R_OK) != 0) {
+                m_log_h3lpr("WARNING: the file <%s> cannot be read, the configuration is not reloaded", file.first.c_str());
+                is_readable = false;
+            }
+            has_changed = has_changed || (mtime != file.second);
+        }
+        has_changed = has_changed && is_readable;
+        if (has_changed) {
+            config_file_.clear();
+            ReadConfigFile_(it->second, "", 0, &clean_str);
+        }
+    }
+    if (is_mpi) {
+        MPI_Bcast(&has_changed, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    }
+    if (!has_changed) {
+        return false;
+    }
+    if (is_mpi) {
+        BroadcastString(&clean_str);
+    }
+
+    // read the new content in a separate parser, with the overrides
+    Parser             file_parser;
+    std::istringstream clean_ss(clean_str);
+    std::string        arg_string;
+    std::set<string>   new_key_set;
+    while (clean_ss >> arg_string) {
+        file_parser.ReadArgString_(arg_string);
+        new_key_set.insert(KeyOf(arg_string));
+    }
+    file_parser.ReadListFiles_();
+    file_parser.ResolveOverrides_();
+    for (const auto &file : file_parser.list_file_map_) {
+        list_file_map_[file.first] = file.second;
+    }
+
+    // update the reloadable arguments and flags
+    bool is_updated = false;
+    for (const string &key : new_key_set) {
+        if (reload_set_.count(key) == 0 && key != "--config") {
+            // warn if an argument that cannot be reloaded has changed
+            const auto new_arg = file_parser.arg_map_.find(key);
+            const auto old_arg = arg_map_.find(key);
+            if (new_arg != file_parser.arg_map_.end() && (old_arg == arg_map_.end() || old_arg->second != new_arg->second)) {
+                m_log_h3lpr("WARNING: %s has changed but is not reloadable, the change is ignored", key.c_str());
+            }
+        }
+    }
+    for (const string &key : reload_set_) {
+        const auto new_arg  = file_parser.arg_map_.find(key);
+        const auto old_arg  = arg_map_.find(key);
+        const bool new_flag = file_parser.flag_set_.count(key) > 0;
+        const bool old_flag = flag_set_.count(key) > 0;
+        // the keys given in the command line are not affected
+        if (old_arg != arg_map_.end() || old_flag) {
+            if (file_key_set_.count(key) == 0) {
+                continue;
+            }
+        }
+        if (new_arg != file_parser.arg_map_.end()) {
+            if (old_arg == arg_map_.end() || old_arg->second != new_arg->second) {
+                m_log_h3lpr("reloading %s=%s", key.c_str(), new_arg->second.c_str());
+                arg_map_[key] = new_arg->second;
+                cache_map_.erase(key);
+                is_updated = true;
+            }
+        } else if (old_arg != arg_map_.end()) {
+            m_log_h3lpr("reloading %s (removed)", key.c_str());
+            arg_map_.erase(old_arg);
+            cache_map_.erase(key);
+            is_updated = true;
+        }
+        if (new_flag != old_flag) {
+            m_log_h3lpr("reloading %s (%s)", key.c_str(), (new_flag) ? "set" : "removed");
+            if (new_flag) {
+                flag_set_.insert(key);
+            } else {
+                flag_set_.erase(key);
+            }
+            is_updated = true;
+        }
+    }
+    file_key_set_ = std::unordered_set<string>(new_key_set.begin(), new_key_set.end());
+    return is_updated;
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief reads a configuration file, removes the comments and append the content to clean_str
+ *
+ * A `--config=filename` entry in the file is replaced by the content of the file (included files).
+ * A relative filename is relative to the directory of the including file.
+ *
+ * A `[section]` entry prefixes the keys that follow it, i.e. `--tol` becomes `--section.tol`, until the next section.
+ * `[]` goes back to the global section. An included file starts in the section of the including file.
+ *
+ * @param filename the file to read
+ * @param section the current section, empty if none
+ * @param depth the include depth, limited to prevent include loops
+ * @param clean_str the cleaned content: arguments separated by spaces
+ */
+void Parser::ReadConfigFile_(const std::string &filename, std::string section, const int depth, std::string *clean_str) {
+    //--------------------------------------------------------------------------
+    m_assert_h3lpr(depth < 16, "too many nested includes while reading <%s>, is there an include loop?", filename.c_str());
+    // open file
+    std::ifstream input_fs(filename.c_str());
+    m_assert_h3lpr(input_fs.is_open(), "Could not open configuration file <%s>", filename.c_str());
+    // keep track of the file for the reload
+    config_file_.push_back(std::make_pair(filename, ModifTime(filename)));
+
+    // the included files are relative to the current one
+    const size_t slash_pos = filename.find_last_of("/");
+    const string dir_name  = (slash_pos != string::npos) ? filename.substr(0, slash_pos + 1) : "";
+
+    // remove extraneous whitespace and comments
+    std::string file_line_str;
+    while (std::getline(input_fs, file_line_str)) {
+        std::string::size_type eol = file_line_str.find('#');
+        if (eol != std::string::npos) {
+            file_line_str.erase(eol);
+        }
+        std::istringstream line_ss(file_line_str);
+        std::string        arg_string;
+        while (line_ss >> arg_string) {
+            // the lists read from a file are relative to the current one
+            const size_t file_pos = arg_string.find("=@");
+            if (file_pos != string::npos && arg_string.length() > file_pos + 2 && arg_string[file_pos + 2] != '/') {
+                arg_string.insert(file_pos + 2, dir_name);
+            }
+            if (arg_string.compare(0, 9, "--config=") == 0) {
+                const string include = arg_string.substr(9);
+                ReadConfigFile_((include[0] == '/') ? include : (dir_name + include), section, depth + 1, clean_str);
+            } else if (arg_string.front() == '[' && arg_string.back() == ']') {
+                section = arg_string.substr(1, arg_string.length() - 2);
+            } else if (!section.empty() && arg_string.compare(0, 2, "--") == 0) {
+                clean_str->append("--" + section + "." + arg_string.substr(2));
+                clean_str->push_back(' ');
+            } else {
+                clean_str->append(arg_string);
+                clean_str->push_back(' ');
+            }
+        }
+    }
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief reads the files given as `--arg=@filename` (also in the overrides) and stores their content in list_file_map_
+ *
+ * The files are read by the rank 0 only and broadcasted, a file that cannot be read is not stored.
+ * If MPI is not initialized, the files are read locally.
+ *
+ * The text is kept for the lifetime of the parser, as the list can be requested again with another type.
+ * This costs one copy of the files per rank, which is fine for lists up to a few MB.
+ *
+ * @warning this call is collective on MPI_COMM_WORLD
+ */
+void Parser::ReadListFiles_() {
+    //--------------------------------------------------------------------------
+    // the list is the same on every rank, in the same order
+    std::set<string> filename_set;
+    for (const auto &it : arg_map_) {
+        if (it.second.length() > 1 && it.second[0] == '@') {
+            filename_set.insert(it.second.substr(1));
+        }
+    }
+    int is_mpi;
+    int rank = 0;
+    MPI_Initialized(&is_mpi);
+    if (is_mpi) {
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    }
+    for (const string &filename : filename_set) {
+        int    is_read = 0;
+        string content;
+        if (rank == 0) {
+            std::ifstream file_fs(filename.c_str(), std::ios::binary | std::ios::ate);
+            if (file_fs.is_open()) {
+                content.resize(static_cast<size_t>(file_fs.tellg()));
+                file_fs.seekg(0);
+                file_fs.read(&content[0], static_cast<std::streamsize>(content.size()));
+                is_read = 1;
+            }
+        }
+        if (is_mpi) {
+            MPI_Bcast(&is_read, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        }
+        if (is_read) {
+            if (is_mpi) {
+                BroadcastString(&content);
+            }
+            list_file_map_[filename] = std::move(content);
         }
     }
     //--------------------------------------------------------------------------
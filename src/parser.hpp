@@ -9,7 +9,9 @@
 
 
 #include <algorithm>
+#include <any>
 #include <cctype>
+#include <charconv>
 #include <cstring>
 #include <fstream>
 #include <iostream>
@@ -17,21 +19,97 @@
 #include <map>
 #include <set>
 #include <sstream>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "macros.hpp"
 
 namespace H3LPR {
 
 //==============================================================================
+/**
+ * @brief true if the type is converted using std::from_chars and std::to_chars (numbers but not characters)
+ */
+template <typename T>
+constexpr bool h3lpr_is_charconv = std::is_arithmetic_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, char>;
+
+/**
+ * @brief converts a value of type T to a string
+ */
+template <typename T>
+inline std::string convertTypeToStr(const T &t) {
+    if constexpr (h3lpr_is_charconv<T>) {
+        char                       buffer[64];
+        const std::to_chars_result res = std::to_chars(buffer, buffer + 64, t);
+        return std::string(buffer, res.ptr);
+    } else {
+        std::ostringstream convert;
+        convert << t;
+        return convert.str();
+    }
+}
+
+/**
+ * @brief specializes convertTypeToStr() for a boolean input
+ */
+template <>
+inline std::string convertTypeToStr(const bool &t) {
+    return (t ? "true" : "false");
+}
+
+/**
+ * @brief specializes convertTypeToStr() for a string input
+ */
+template <>
+inline std::string convertTypeToStr(const std::string &t) {
+    return t;
+}
+
+/**
+ * @brief converts the characters in [first, last[ to a number using std::from_chars (no locale, no stream)
+ *
+ * If the conversion fails, the error is logged (and asserted in debug) and the value is the one of the longest valid prefix,
+ * or is left unchanged if there is none, i.e. "1.5" gives 1 for an integer.
+ *
+ * @return true if the conversion succeeded
+ */
+template <typename T>
+inline bool convertCharsToNumber(const char *first, const char *last, T *value) {
+    //--------------------------------------------------------------------------
+    const char *begin = first;
+    // from_chars does not accept a leading '+'
+    if (begin != last && *begin == '+') {
+        ++begin;
+    }
+    const std::from_chars_result res     = std::from_chars(begin, last, *value);
+    const bool                   success = (res.ec == std::errc() && res.ptr == last);
+    if (!success) {
+        const std::string str(first, last);
+        m_log_h3lpr("ERROR: the string <%s> cannot be converted into a number, %s is used", str.c_str(), convertTypeToStr<T>(*value).c_str());
+        m_assert_h3lpr(success, "The string <%s> cannot be converted into a number", str.c_str());
+    }
+    return success;
+    //--------------------------------------------------------------------------
+}
+
 /**
  * @brief converts the input string to the chosen type
+ *
+ * numbers are converted using @ref convertCharsToNumber, the other types use a std::istringstream.
+ * A number that cannot be converted gives the value of its longest valid prefix or 0.
  */
 template <typename T>
 inline T convertStrToType(const std::string &s) {
     //--------------------------------------------------------------------------
-    T                  value;
-    std::istringstream convert(s);
-    convert >> value;
+    T value{};
+    if constexpr (h3lpr_is_charconv<T>) {
+        convertCharsToNumber<T>(s.data(), s.data() + s.size(), &value);
+    } else {
+        std::istringstream convert(s);
+        convert >> value;
+    }
     return value;
     //--------------------------------------------------------------------------
 }
@@ -43,7 +121,7 @@ template <>
 inline bool convertStrToType(const std::string &s) {
     m_assert_h3lpr(s == "true" || s == "false", "The string <%s> cannot be transformed into a boolean value", s.c_str());
     //--------------------------------------------------------------------------
-    bool               value;
+    bool               value = false;
     std::istringstream convert(s);
     convert >> std::boolalpha >> value;
     return value;
@@ -58,37 +136,72 @@ inline std::string convertStrToType(const std::string &s) {
     return s;
 }
 
-//==============================================================================
 /**
- * @brief converts a value of type T to a string
+ * @brief converts a list of values separated by commas and/or whitespaces and append them to values
+ *
+ * The list is read in a single pass, numbers are converted in place using std::from_chars.
+ *
+ * @param first the first character of the list
+ * @param last the past-the-end character of the list
+ * @param values the converted values are appended to it
  */
 template <typename T>
-inline std::string convertTypeToStr(const T &t) {
-    std::ostringstream convert;
-    convert << t;
-    return convert.str();
+inline void convertStrToVector(const char *first, const char *last, std::vector<T> *values) {
+    //--------------------------------------------------------------------------
+    auto is_separator = [](const char c) { return c == ',' || std::isspace(static_cast<unsigned char>(c)); };
+
+    const char *curr = first;
+    while (curr != last) {
+        // skip the separators
+        if (is_separator(*curr)) {
+            ++curr;
+            continue;
+        }
+        // find the end of the value
+        const char *end = curr;
+        while (end != last && !is_separator(*end)) {
+            ++end;
+        }
+        // convert without any copy if possible
+        if constexpr (h3lpr_is_charconv<T>) {
+            T value{};
+            convertCharsToNumber<T>(curr, end, &value);
+            values->push_back(value);
+        } else {
+            values->push_back(convertStrToType<T>(std::string(curr, end)));
+        }
+        curr = end;
+    }
+    //--------------------------------------------------------------------------
 }
 
 /**
- * @brief specializes convertTypeToStr() for a boolean input
+ * @brief first string is the documentation and second one is the default argument
  */
-template <>
-inline std::string convertTypeToStr(const bool &t) {
-    return (t ? "true" : "false");
-}
+using h3lpr_docargstr = std::tuple<std::string, std::string>;
 
 /**
- * @brief specializes convertTypeToStr() for a string input
+ * @brief typed value of an argument, stored after the first request
  */
-template <>
-inline std::string convertTypeToStr(const std::string &t) {
-    return t;
-}
+struct h3lpr_cacheval {
+    std::any    value;       //!< the value returned, of type T
+    std::string doc;         //!< the documentation registered with the value
+    bool        is_default;  //!< true if the value is the default one (the key has not been provided)
+};
 
 /**
- * @brief first string is the documentation and second one is the default argument
+ * @brief returns true if two values are equal, false if they cannot be compared
  */
-using h3lpr_docargstr = std::tuple<std::string, std::string>;
+template <typename T>
+inline bool h3lprIsEqual(const T &a, const T &b) {
+    if constexpr (std::is_convertible_v<decltype(std::declval<const T &>() == std::declval<const T &>()), bool>) {
+        return a == b;
+    } else {
+        return false;
+    }
+}
+
+class ParserView;
 
 //==============================================================================
 /**
@@ -108,14 +221,32 @@ class Parser {
     std::map<std::string, std::string>     doc_flag_map_;  //!< contains the documentation for the flags needed in the code
     std::map<std::string, h3lpr_docargstr> doc_arg_map_;   //!< contains the documentation for the arguments needed in the code
 
-    std::set<std::string>              flag_set_;  //<! contains the list of flags given by the user
-    std::map<std::string, std::string> arg_map_;   //<! contains the list of the arguments + values given by the user
+    std::unordered_set<std::string>              flag_set_;  //<! contains the list of flags given by the user
+    std::unordered_map<std::string, std::string> arg_map_;   //<! contains the list of the arguments + values given by the user
+
+    std::unordered_map<std::string, h3lpr_cacheval> cache_map_;  //<! the typed values already returned, by key
+
+    std::set<std::string>                       reload_set_;    //<! the arguments and flags that can be reloaded
+    std::unordered_set<std::string>             file_key_set_;  //<! the arguments and flags read from the configuration file
+    std::vector<std::pair<std::string, double>> config_file_;   //<! the configuration files read and their modification time (rank 0 only)
+
+    std::unordered_map<std::string, std::string> list_file_map_;  //<! the content of the files given as `--arg=@filename`, by filename
+
+    bool is_finalized_ = false;  //<! true once Finalize has been called, the errors can no longer be reported at the Finalize
 
    public:
     explicit Parser();
     explicit Parser(const int argc, const char **argv);
 
     void Finalize();
+    bool Sync();
+
+    /** @brief allows the argument or the flag to be updated by @ref Sync when the configuration file changes */
+    void MarkReloadable(const std::string &arg) {
+        //----------------------------------------------------------------------
+        reload_set_.insert(arg);
+        //----------------------------------------------------------------------
+    }
 
     //--------------------------------------------------------------------------
 
@@ -151,6 +282,27 @@ class Parser {
         //----------------------------------------------------------------------
     }
 
+    /**
+     * @brief return a list of any length of values of a given argument and register the associated documentation. Fails if the list has not been provided
+     *
+     * the values are separated by commas or whitespaces, `--arg=@filename` reads them from the file.
+     * The file is read by the rank 0 at the construction of the parser, a relative filename given in a configuration file is relative to it.
+     */
+    template <typename T>
+    std::vector<T> GetVector(const std::string &arg, const std::string &doc) {
+        m_verb_h3lpr("looking for %s", arg.c_str());
+        return ParseVector_<T>(arg, doc, true);
+    }
+
+    /** @brief return a list of any length of values of a given argument and register the associated documentation. */
+    template <typename T>
+    std::vector<T> GetVector(const std::string &arg, const std::string &doc, const std::vector<T> &defval) {
+        //----------------------------------------------------------------------
+        m_verb_h3lpr("looking for %s", arg.c_str());
+        return ParseVector_<T>(arg, doc, false, defval);
+        //----------------------------------------------------------------------
+    }
+
     /** @brief Test if a flag has been registered and register the associated documentation */
     bool GetFlag(const std::string arg, const std::string &doc) {
         //----------------------------------------------------------------------
@@ -166,6 +318,18 @@ class Parser {
         //----------------------------------------------------------------------
     }
 
+    ParserView Section(const std::string &section);
+
+    /** @brief returns true once Finalize has been called */
+    bool is_finalized() const { return is_finalized_; }
+
+    /** @brief returns true if a value has been provided for the argument, no documentation is registered */
+    bool HasArg(const std::string &arg) const {
+        //----------------------------------------------------------------------
+        return (arg_map_.count(arg) > 0);
+        //----------------------------------------------------------------------
+    }
+
     /** @brief force the call of the help at the coming Finalize call */
     void ForceHelp() {
         //----------------------------------------------------------------------
@@ -173,10 +337,66 @@ class Parser {
         //----------------------------------------------------------------------
     }
 
+    /** @brief force the call of the help and the failure at the coming Finalize call */
+    void ForceError() {
+        //----------------------------------------------------------------------
+        flag_set_.insert("--help");
+        flag_set_.insert("--error");
+        //----------------------------------------------------------------------
+    }
+
    protected:
     void ReadArgString_(const std::string &arg_string);
     bool ParseFlag_(const std::string &flagkey, const std::string &doc);
     void ParseLogFile_();
+    void ResolveOverrides_();
+    void ReadConfigFile_(const std::string &filename, std::string section, const int depth, std::string *clean_str);
+    void ReadListFiles_();
+
+    static std::string SectionOf_(const std::string &key);
+
+    /**
+     * @brief converts the value of an argument into a list of values, `@filename` is replaced by the content of the file
+     *
+     * the content of the file has been read by the rank 0 and broadcasted at the construction, see @ref ReadListFiles_
+     */
+    template <typename T>
+    std::vector<T> ReadVector_(const std::string &str) const {
+        //----------------------------------------------------------------------
+        std::vector<T> values;
+        if (!str.empty() && str[0] == '@') {
+            const auto it = list_file_map_.find(str.substr(1));
+            m_assert_h3lpr(it != list_file_map_.end(), "Could not read the file <%s>", str.substr(1).c_str());
+            if (it != list_file_map_.end()) {
+                convertStrToVector<T>(it->second.data(), it->second.data() + it->second.size(), &values);
+            }
+        } else {
+            convertStrToVector<T>(str.data(), str.data() + str.size(), &values);
+        }
+        return values;
+        //----------------------------------------------------------------------
+    }
+
+    /**
+     * @brief returns the cached value of a key requested with the same type and documentation, nullptr if there is none
+     *
+     * if the key has not been provided, the cached value is returned only if the requested default value is the same,
+     * and never to a strict request: the missing argument must then be reported
+     */
+    template <typename T>
+    const T *GetCached_(const std::string &argkey, const std::string &doc, const bool strict, const T &defval) const {
+        //----------------------------------------------------------------------
+        const auto it = cache_map_.find(argkey);
+        if (it == cache_map_.end() || it->second.doc != doc) {
+            return nullptr;
+        }
+        const T *cached = std::any_cast<T>(&it->second.value);
+        if (cached != nullptr && it->second.is_default && (strict || !h3lprIsEqual(*cached, defval))) {
+            return nullptr;
+        }
+        return cached;
+        //----------------------------------------------------------------------
+    }
 
     /**
      * @brief Search for an argument and returns the value corresponding to the requested key
@@ -187,6 +407,9 @@ class Parser {
      * 
      * @warning the documentation is overwritten in case the argument has already been requested
      *
+     * The value is cached: a new request with the same type, documentation (and default value) returns the cached value,
+     * without any conversion nor registration of the documentation.
+     *
      * @tparam T
      * @param argkey the key to look for
      * @param doc the documentation that will be registered to this key
@@ -197,6 +420,12 @@ class Parser {
     template <typename T>
     T ParseArg_(const std::string &argkey, const std::string &doc, const bool strict, const T defval = T()) {
         //----------------------------------------------------------------------
+        // the value might have been already requested
+        const T *cached = GetCached_<T>(argkey, doc, strict, defval);
+        if (cached != nullptr) {
+            return *cached;
+        }
+
         // look for the key
         const auto it = arg_map_.find(argkey);
 
@@ -210,6 +439,7 @@ class Parser {
 
             doc_arg_map_[argkey] = h3lpr_docargstr(doc, doc_val);
             max_arg_length       = m_max(max_arg_length, msg_key.length());
+            cache_map_[argkey]   = h3lpr_cacheval{value, doc, false};
             // return the conversion of the string to the type
             return value;
         } else {
@@ -234,6 +464,7 @@ class Parser {
                 // max_arg_length       = m_max(max_arg_length, argkey.length());
                 doc_arg_map_[argkey] = h3lpr_docargstr(doc, doc_val);
                 max_arg_length       = m_max(max_arg_length, msg_key.length());
+                cache_map_[argkey]   = h3lpr_cacheval{defval, doc, true};
             }
             // return the stored default value
             return defval;
@@ -252,6 +483,12 @@ class Parser {
     template <typename T, int C>
     std::array<T, C> ParseArgs_(const std::string &argkey, const std::string &doc, const bool strict, const std::array<T, C> defval = std::array<T, C>()) {
         //----------------------------------------------------------------------
+        // the value might have been already requested
+        const std::array<T, C> *cached = GetCached_<std::array<T, C>>(argkey, doc, strict, defval);
+        if (cached != nullptr) {
+            return *cached;
+        }
+
         // look for the key
         const auto it = arg_map_.find(argkey);
 
@@ -274,24 +511,13 @@ class Parser {
             // doc_arg_map_[argkey] = doc + " (default value: " + str_defval + " )";
             // max_arg_length       = m_max(max_arg_length, argkey.length());
 
-            std::array<T, C> value;
+            // read the list and check its length
+            const std::vector<T> list = ReadVector_<T>(it->second);
+            m_assert_h3lpr(list.size() == C, "the provided argument <%s> has %ld elements while %d are required", it->second.c_str(), list.size(), C);
 
-            // here we copy the argument string and loop on it to fill the array
-            size_t            pos;
-            std::string       full_array      = it->second;
-            const std::string array_delimiter = ",";
-            int               count           = 0;
-            while ((pos = full_array.find(",")) != std::string::npos) {
-                m_assert_h3lpr(count < (C - 1), "the provided argument <%s> is too long, only %d elements are required", it->second.c_str(), C);
-                // read the current value
-                std::string cval = full_array.substr(0, pos);
-                value[count]     = convertStrToType<T>(cval);
-                count += 1;
-                // forget about it
-                full_array.erase(0, pos + array_delimiter.length());
-            }
-            // add the last one
-            value[count] = convertStrToType<T>(full_array);
+            std::array<T, C> value;
+            std::copy_n(list.begin(), m_min(list.size(), static_cast<size_t>(C)), value.begin());
+            cache_map_[argkey] = h3lpr_cacheval{value, doc, false};
 
             // return the conversion of the string to the type
             return value;
@@ -316,14 +542,235 @@ class Parser {
                 std::string msg_key  = argkey + "[=" + doc_val + "]";
                 doc_arg_map_[argkey] = h3lpr_docargstr(doc, doc_val);
                 max_arg_length       = m_max(max_arg_length, msg_key.length());
+                cache_map_[argkey]   = h3lpr_cacheval{defval, doc, true};
             }
             // return the stored default value
             return defval;
         }
         //----------------------------------------------------------------------
     }
+
+    /**
+     * @brief Search for an argument and returns the list of values corresponding to the requested key
+     *
+     * Similar to the function @ref ParseArgs_ but the length of the list is not known
+     *
+     * @tparam T the type of the values
+     */
+    template <typename T>
+    std::vector<T> ParseVector_(const std::string &argkey, const std::string &doc, const bool strict, const std::vector<T> &defval = std::vector<T>()) {
+        //----------------------------------------------------------------------
+        // the value might have been already requested
+        const std::vector<T> *cached = GetCached_<std::vector<T>>(argkey, doc, strict, defval);
+        if (cached != nullptr) {
+            return *cached;
+        }
+
+        // look for the key
+        const auto it = arg_map_.find(argkey);
+
+        // from the list obtain the default values as a string
+        std::string str_defval;
+        for (size_t i = 0; i < defval.size(); ++i) {
+            str_defval += ((i > 0) ? "," : "") + convertTypeToStr<T>(defval[i]);
+        }
+
+        std::string doc_val = str_defval;
+        if (it != arg_map_.end()) {
+            m_verb_h3lpr("Found the value for key %s as %s\n", argkey.data(), it->second.data());
+            // read the list
+            const std::vector<T> value = ReadVector_<T>(it->second);
+            cache_map_[argkey]         = h3lpr_cacheval{value, doc, false};
+
+            // register the provided value, `@filename` for a file
+            doc_val              = it->second;
+            doc_arg_map_[argkey] = h3lpr_docargstr(doc, doc_val);
+            max_arg_length       = m_max(max_arg_length, argkey.length() + doc_val.length() + 3);
+            return value;
+        } else {
+            // no key is found, if the search was strict we need to display the help to help the user
+            if (strict) {
+                flag_set_.insert("--help");
+                flag_set_.insert("--error");
+                doc_val = "!MISSING ARGUMENT!";
+            } else {
+                cache_map_[argkey] = h3lpr_cacheval{defval, doc, true};
+            }
+            doc_arg_map_[argkey] = h3lpr_docargstr(doc, doc_val);
+            max_arg_length       = m_max(max_arg_length, argkey.length() + doc_val.length() + 3);
+            // return the stored default value
+            return defval;
+        }
+        //----------------------------------------------------------------------
+    }
 };
 
+//==============================================================================
+/**
+ * @brief A view on a section of a Parser: the argument `--tol` is requested as `--section.tol`
+ *
+ * The view does not hold any value, it is cheap to create and to copy.
+ */
+class ParserView {
+   protected:
+    Parser     *parser_;   //!< the parser holding the values
+    std::string section_;  //!< the section, i.e. solver.rhs
+
+   public:
+    explicit ParserView(Parser *parser, const std::string &section) : parser_(parser), section_(section) {}
+
+    std::string section() const { return section_; }
+
+    /** @brief returns the view on a subsection: `sub` is the section `section.sub` */
+    ParserView Section(const std::string &sub) const {
+        return ParserView(parser_, (section_.empty()) ? sub : (section_ + "." + sub));
+    }
+
+    /** @brief returns the full key of an argument: `--section.arg` for `--arg` */
+    std::string Key(const std::string &arg) const {
+        //----------------------------------------------------------------------
+        m_assert_h3lpr(arg.compare(0, 2, "--") == 0, "the argument <%s> must start with --", arg.c_str());
+        return (section_.empty()) ? arg : ("--" + section_ + "." + arg.substr(2));
+        //----------------------------------------------------------------------
+    }
+
+    /** @brief see Parser::GetValue() */
+    template <typename T>
+    T GetValue(const std::string &arg, const std::string &doc) {
+        return parser_->GetValue<T>(Key(arg), doc);
+    }
+
+    /** @brief see Parser::GetValue() */
+    template <typename T>
+    T GetValue(const std::string &arg, const std::string &doc, const T defval) {
+        return parser_->GetValue<T>(Key(arg), doc, defval);
+    }
+
+    /** @brief see Parser::GetValues() */
+    template <typename T, int C>
+    std::array<T, C> GetValues(const std::string &arg, const std::string &doc) {
+        return parser_->GetValues<T, C>(Key(arg), doc);
+    }
+
+    /** @brief see Parser::GetValues() */
+    template <typename T, int C>
+    std::array<T, C> GetValues(const std::string &arg, const std::string &doc, const std::array<T, C> defval) {
+        return parser_->GetValues<T, C>(Key(arg), doc, defval);
+    }
+
+    /** @brief see Parser::GetVector() */
+    template <typename T>
+    std::vector<T> GetVector(const std::string &arg, const std::string &doc) {
+        return parser_->GetVector<T>(Key(arg), doc);
+    }
+
+    /** @brief see Parser::GetVector() */
+    template <typename T>
+    std::vector<T> GetVector(const std::string &arg, const std::string &doc, const std::vector<T> &defval) {
+        return parser_->GetVector<T>(Key(arg), doc, defval);
+    }
+
+    /** @brief see Parser::GetFlag() */
+    bool GetFlag(const std::string &arg, const std::string &doc) { return parser_->GetFlag(Key(arg), doc); }
+
+    /** @brief see Parser::TestFlag() */
+    bool TestFlag(const std::string &arg) { return parser_->TestFlag(Key(arg)); }
+
+    /** @brief see Parser::HasArg() */
+    bool HasArg(const std::string &arg) const { return parser_->HasArg(Key(arg)); }
+
+    /** @brief see Parser::MarkReloadable() */
+    void MarkReloadable(const std::string &arg) { parser_->MarkReloadable(Key(arg)); }
+
+    /** @brief see Parser::ForceError() */
+    void ForceError() { parser_->ForceError(); }
+
+    /** @brief see Parser::is_finalized() */
+    bool is_finalized() const { return parser_->is_finalized(); }
+};
+
+/** @brief returns a view on a section: the arguments requested through the view are prefixed by the section */
+inline ParserView Parser::Section(const std::string &section) {
+    return ParserView(this, section);
+}
+
+//==============================================================================
+/**
+ * @brief calls f with the compile-time value among V0, Vs... that is equal to value (the last one if there is none)
+ */
+template <auto V0, auto... Vs, typename F>
+inline std::invoke_result_t<F, std::integral_constant<decltype(V0), V0>> DispatchValue(const decltype(V0) value, F &&f) {
+    //--------------------------------------------------------------------------
+    if constexpr (sizeof...(Vs) == 0) {
+        return f(std::integral_constant<decltype(V0), V0>());
+    } else {
+        if (value == V0) {
+            return f(std::integral_constant<decltype(V0), V0>());
+        }
+        return DispatchValue<Vs...>(value, std::forward<F>(f));
+    }
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief reads the value of an argument and calls f with the matching compile-time value, see @ref Dispatch
+ */
+template <auto V0, auto... Vs, typename P, typename F>
+inline std::invoke_result_t<F, std::integral_constant<decltype(V0), V0>> DispatchArg(P *parser, const std::string &arg, const std::string &doc, const bool strict, const decltype(V0) defval, F &&f) {
+    //--------------------------------------------------------------------------
+    using T = decltype(V0);
+    // list the supported values in the documentation
+    std::string supported = convertTypeToStr<T>(V0);
+    ((supported += "," + convertTypeToStr<T>(Vs)), ...);
+    const std::string doc_supported = doc + " (supported: " + supported + ")";
+
+    const T value = (strict) ? parser->template GetValue<T>(arg, doc_supported) : parser->template GetValue<T>(arg, doc_supported, defval);
+    // a missing argument has already been reported
+    const bool is_missing   = strict && !parser->HasArg(arg);
+    const bool is_supported = (value == V0) || ((value == Vs) || ...);
+    if (!is_supported && !is_missing) {
+        m_log_h3lpr("ERROR: the value %s=%s is not supported, the supported values are %s", arg.c_str(), convertTypeToStr<T>(value).c_str(), supported.c_str());
+        parser->ForceError();
+    }
+    // after the Finalize call, the error would never be reported: fail now instead of calling f with V0
+    if ((!is_supported || is_missing) && parser->is_finalized()) {
+        m_log_h3lpr("ERROR: the argument %s cannot be dispatched after the Finalize call", arg.c_str());
+        MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+    return DispatchValue<V0, Vs...>((is_supported) ? value : V0, std::forward<F>(f));
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief reads the value of an argument and calls f with the matching compile-time value, i.e. for a templated kernel
+ *
+ * ```
+ * Dispatch<4, 8, 16>(&parser, "--bs", "the block size", 8, [&](auto BS) { Kernel<BS>(data); });
+ * ```
+ *
+ * The supported values are added to the documentation of the argument.
+ * If the value is not supported, the help and the failure are forced at the coming Finalize call (as for a missing argument)
+ * and f is called with V0. After the Finalize call, an unsupported or missing value aborts the program instead.
+ *
+ * @param parser a Parser or a ParserView
+ * @param arg the key of the argument
+ * @param doc the documentation of the argument
+ * @param defval the default value, must be one of the supported values
+ * @param f the callable, receives a std::integral_constant holding the value
+ */
+template <auto V0, auto... Vs, typename P, typename F>
+inline std::invoke_result_t<F, std::integral_constant<decltype(V0), V0>> Dispatch(P *parser, const std::string &arg, const std::string &doc, const decltype(V0) defval, F &&f) {
+    return DispatchArg<V0, Vs...>(parser, arg, doc, false, defval, std::forward<F>(f));
+}
+
+/**
+ * @brief same as @ref Dispatch without default value: the argument must be provided
+ */
+template <auto V0, auto... Vs, typename P, typename F>
+inline std::invoke_result_t<F, std::integral_constant<decltype(V0), V0>> Dispatch(P *parser, const std::string &arg, const std::string &doc, F &&f) {
+    return DispatchArg<V0, Vs...>(parser, arg, doc, true, V0, std::forward<F>(f));
+}
+
 };  // namespace H3LPR
 
 #endif
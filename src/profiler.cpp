@@ -5,14 +5,25 @@
  */
 #include "profiler.hpp"
 
+#include <fcntl.h>
 #include <mpi.h>
-#include <stack>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
 
 using std::map;
 using std::string;
 
 namespace H3LPR {
 
+static constexpr double clock_min_span = 1.0;  // min time spanned by the clock samples to fit a drift [s]
+
 static constexpr int    upper_rank = 1000; // approximates the infinity of procs
 static map<int, double> t_nu       = {{0, 0.0},
                                    {1, 6.314},
@@ -61,12 +72,121 @@ double t_nu_interp(const int nu) {
     //--------------------------------------------------------------------------
 }
 
+/**
+ * @brief the files of /proc read by @ref SampleResource, opened once per process and read with pread
+ *
+ * /proc/self is resolved at the opening: after a fork the child must open the files again to read its own counters.
+ */
+struct ResourceFiles {
+    int    statm = -1;   //!< /proc/self/statm
+    int    io    = -1;   //!< /proc/self/io
+    pid_t  pid   = -1;   //!< the process that has opened the files
+    double page  = 0.0;  //!< the size of a page [B]
+
+    ResourceFiles() {
+        page = static_cast<double>(sysconf(_SC_PAGESIZE));
+        Open();
+    }
+    ~ResourceFiles() { Close(); }
+
+    /** @brief opens the files for the calling process */
+    void Open() {
+        Close();
+        statm = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+        io    = open("/proc/self/io", O_RDONLY | O_CLOEXEC);
+        pid   = getpid();
+    }
+    void Close() {
+        if (statm >= 0) {
+            close(statm);
+        }
+        if (io >= 0) {
+            close(io);
+        }
+        statm = -1;
+        io    = -1;
+    }
+};
+
+/**
+ * @brief reads a file of /proc from its beginning in buffer, returns false if nothing has been read
+ */
+static bool ReadProc(const int fd, char* buffer, const size_t size) {
+    if (fd < 0) {
+        return false;
+    }
+    const ssize_t n_read = pread(fd, buffer, size - 1, 0);
+    buffer[(n_read > 0) ? n_read : 0] = '\0';
+    return (n_read > 0);
+}
+
+/**
+ * @brief reads the current value of the process resource counters
+ *
+ * - page faults and context switches are obtained from getrusage
+ * - the resident set size is read from /proc/self/statm
+ * - the read/written bytes (rchar/wchar, including the page cache and the network file systems) are read from /proc/self/io
+ *
+ * The files are opened once per process and only read afterwards, which costs one syscall per file and per sample.
+ * A counter that cannot be read is set to 0.
+ *
+ * @param res the counters, indexed by Resource_t
+ */
+void SampleResource(double res[H3LPR_RES_N]) {
+    //--------------------------------------------------------------------------
+    static ResourceFiles files;
+    if (files.pid != getpid()) {
+        files.Open();
+    }
+    for (int ir = 0; ir < H3LPR_RES_N; ++ir) {
+        res[ir] = 0.0;
+    }
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        res[H3LPR_RES_MINFLT] = static_cast<double>(usage.ru_minflt);
+        res[H3LPR_RES_MAJFLT] = static_cast<double>(usage.ru_majflt);
+        res[H3LPR_RES_NVCSW]  = static_cast<double>(usage.ru_nvcsw);
+        res[H3LPR_RES_NIVCSW] = static_cast<double>(usage.ru_nivcsw);
+    }
+    char buffer[256];
+    if (ReadProc(files.statm, buffer, 256)) {
+        long size_page, rss_page;
+        if (sscanf(buffer, "%ld %ld", &size_page, &rss_page) == 2) {
+            res[H3LPR_RES_RSS] = static_cast<double>(rss_page) * files.page;
+        }
+    }
+    if (ReadProc(files.io, buffer, 256)) {
+        const char* rchar = strstr(buffer, "rchar:");
+        const char* wchar = strstr(buffer, "wchar:");
+        if (rchar != nullptr) {
+            res[H3LPR_RES_READ] = static_cast<double>(strtoll(rchar + 6, nullptr, 10));
+        }
+        if (wchar != nullptr) {
+            res[H3LPR_RES_WRITE] = static_cast<double>(strtoll(wchar + 6, nullptr, 10));
+        }
+    }
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief returns the local value of a resource counter accumulated in a block, 0 if the resources are not measured
+ *
+ * @param name the name of a child of the current block or the path of a block (ex: root/step/substep)
+ * @param res the counter
+ */
+double Profiler::GetResource(const string& name, const Resource_t res) const noexcept {
+    const TimerBlock* block = FindBlock_(name);
+    m_assert_h3lpr(block != nullptr, "you requested the resources of %s which is neither a child nor a path", name.c_str());
+    return block->res_acc(res);
+}
+
 /**
  * @brief defines a simple block with a given name
  */
 TimerBlock::TimerBlock(string name) {
     //--------------------------------------------------------------------------
     name_  = name;
+    path_  = name;
     t0_    = -1.0;
     t1_    = -1.0;
     count_ = 0;
@@ -104,6 +224,24 @@ void TimerBlock::Resume() {
     t0_ = MPI_Wtime();
 }
 
+/**
+ * @brief samples the resource counters at the start of the block
+ */
+void TimerBlock::StartResource() {
+    SampleResource(res_t0_);
+}
+
+/**
+ * @brief accumulates the increase of the resource counters since @ref StartResource
+ */
+void TimerBlock::StopResource() {
+    double res_t1[H3LPR_RES_N];
+    SampleResource(res_t1);
+    for (int ir = 0; ir < H3LPR_RES_N; ++ir) {
+        res_acc_[ir] += res_t1[ir] - res_t0_[ir];
+    }
+}
+
 // /**
 //  * @brief start the timer using the time provided as argument
 //  * 
@@ -185,6 +323,7 @@ double TimerBlock::GetChildrenTime(string child_name) noexcept{
  */
 void TimerBlock::SetParent(TimerBlock* parent) {
     parent_ = parent;
+    path_   = parent->path() + "/" + name_;
     // is_root_ = false;
 }
 
@@ -208,9 +347,34 @@ double TimerBlock::time_acc() const {
     }
 }
 
+/**
+ * @brief returns the local time accumulated since the last call to @ref ResetCost
+ *
+ * If the block is running, the time elapsed since its start is included.
+ *
+ * @param wtime the current time, used if the block is running
+ */
+double TimerBlock::cost(const double wtime) const {
+    const double running = (t0_ > -0.5) ? (wtime - t0_) : 0.0;
+    return time_acc_ + running - time_rst_;
+}
+
+/**
+ * @brief resets the cost of the block, the accumulated time is not affected
+ *
+ * @param wtime the current time, used if the block is running
+ */
+void TimerBlock::ResetCost(const double wtime) {
+    const double running = (t0_ > -0.5) ? (wtime - t0_) : 0.0;
+    time_rst_            = time_acc_ + running;
+}
+
 /**
  * @brief display the time for the TimerBlock
- * 
+ *
+ * The line written in the csv file is: name;level;mean time;percent;mean time per call;mean count;min time;max time;std time;min count;max count;
+ * mean wait;max wait, followed by the mean;max of every resource counter (see Resource_t). The wait and the resources are 0 if not measured.
+ *
  * @param file pointer to the file to write the results
  * @param level the indentation level
  * @param total_time the total time used to compute percentages
@@ -254,12 +418,17 @@ void TimerBlock::Disp(FILE* file, const int level, const double total_time, cons
         MPI_Allreduce(&local_count, &min_count, 1, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
         MPI_Allreduce(&local_count, &max_count, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
 
-        // compute times passed inside + children
-        double local_time = time_acc_;
-        double sum_time = 0.0, min_time = 0.0, max_time = 0.0;
-        MPI_Allreduce(&local_time, &sum_time, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        // compute times passed inside + children, together with the time spent waiting for the other ranks (only measured for synchronizing blocks)
+        double local_time  = time_acc_;
+        double local_tw[2] = {time_acc_, wait_acc_};
+        double sum_tw[2]   = {0.0, 0.0};
+        double max_tw[2]   = {0.0, 0.0};
+        double min_time    = 0.0;
+        MPI_Allreduce(local_tw, sum_tw, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
         MPI_Allreduce(&local_time, &min_time, 1, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
-        MPI_Allreduce(&local_time, &max_time, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        MPI_Allreduce(local_tw, max_tw, 2, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        double sum_time = sum_tw[0];
+        double max_time = max_tw[0];
 
         double mean_time           = sum_time / comm_size;
         double mean_time_per_count = sum_time / total_count;
@@ -272,6 +441,19 @@ void TimerBlock::Disp(FILE* file, const int level, const double total_time, cons
         double std_time   = (comm_size > 1) ? (sqrt(sum_timesq / (comm_size - 1))) : 0.0;
         double ci_90_time = (comm_size > 1) ? (std_time / sqrt(comm_size) * t_nu_interp(comm_size - 1)) : 0.0;
 
+        double mean_wait = sum_tw[1] / comm_size;
+        double max_wait  = max_tw[1];
+
+        // resource counters, zero if not measured
+        double mean_res[H3LPR_RES_N], max_res[H3LPR_RES_N];
+        MPI_Allreduce(res_acc_, mean_res, H3LPR_RES_N, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        MPI_Allreduce(res_acc_, max_res, H3LPR_RES_N, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        bool has_res = false;
+        for (int ir = 0; ir < H3LPR_RES_N; ++ir) {
+            mean_res[ir] /= comm_size;
+            has_res = has_res || (max_res[ir] != 0.0);
+        }
+
         // printf the important information
         if (rank == 0) {
 #if (M_COLOR_PROF)
@@ -288,15 +470,33 @@ void TimerBlock::Disp(FILE* file, const int level, const double total_time, cons
 #else
             printf("%-60.60s %s%09.6f %% -> %07.4f [s] +- %07.4f [s] \t\t\t(%.4f [s/call], %.0f calls)\n", myname.c_str(), shifter.c_str(), glob_percent, mean_time, ci_90_time, mean_time_per_count, max_count);
 #endif
+            // split the time between the wait for the other ranks and the work
+            if (max_wait > 0.0) {
+                printf("%-60.60s %s   -> wait for peers = %07.4f [s] (max = %07.4f [s]), work/comm = %07.4f [s]\n", "", shifter.c_str(), mean_wait, max_wait, mean_time - mean_wait);
+            }
+            // explain the time using the resources
+            if (has_res) {
+                constexpr double mb = 1024.0 * 1024.0;
+                printf("%-60.60s %s   -> faults = %.0f/%.0f (minor/major), ctx switches = %.0f/%.0f (vol/invol), rss += %.2f [MB] (max = %.2f [MB]), read = %.2f [MB], write = %.2f [MB]\n", "", shifter.c_str(),
+                       mean_res[H3LPR_RES_MINFLT], mean_res[H3LPR_RES_MAJFLT], mean_res[H3LPR_RES_NVCSW], mean_res[H3LPR_RES_NIVCSW], mean_res[H3LPR_RES_RSS] / mb, max_res[H3LPR_RES_RSS] / mb, mean_res[H3LPR_RES_READ] / mb, mean_res[H3LPR_RES_WRITE] / mb);
+            }
             // printf in the file
             if (file != nullptr) {
-                fprintf(file, "%s;%d;%.8f;%.8f;%.8f;%.0f;%.8f;%.8f;%.8f;%.0f;%.0f\n", name_.c_str(), level, mean_time, glob_percent, mean_time_per_count, mean_count, min_time, max_time, std_time, min_count, max_count);
+                fprintf(file, "%s;%d;%.8f;%.8f;%.8f;%.0f;%.8f;%.8f;%.8f;%.0f;%.0f;%.8f;%.8f", name_.c_str(), level, mean_time, glob_percent, mean_time_per_count, mean_count, min_time, max_time, std_time, min_count, max_count, mean_wait, max_wait);
+                for (int ir = 0; ir < H3LPR_RES_N; ++ir) {
+                    fprintf(file, ";%.0f;%.0f", mean_res[ir], max_res[ir]);
+                }
+                fprintf(file, "\n");
             }
         }
     } else if (name_ != "root") {
         // we have a total count = 0, nothing to do for the counter
         if ((rank == 0) && (file != nullptr)) {
-            fprintf(file, "%s;%d;%.8f;%.8f;%.8f;%.0f;%.8f;%.8f;%.8f;%.0f;%.0f\n", name_.c_str(), level, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+            fprintf(file, "%s;%d;%.8f;%.8f;%.8f;%.0f;%.8f;%.8f;%.8f;%.0f;%.0f;%.8f;%.8f", name_.c_str(), level, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+            for (int ir = 0; ir < H3LPR_RES_N; ++ir) {
+                fprintf(file, ";%.0f;%.0f", 0.0, 0.0);
+            }
+            fprintf(file, "\n");
         }
     }
 
@@ -343,23 +543,98 @@ void TimerBlock::Disp(FILE* file, const int level, const double total_time, cons
     }
 }
 
+/**
+ * @brief appends the current block and all its children to the list
+ *
+ * The order of the list follows the order of the (ordered) children map, hence it is the same on every rank
+ * as long as the tree is the same.
+ *
+ * @param list the list to fill
+ */
+void TimerBlock::Flatten(std::vector<const TimerBlock*>* list) const {
+    list->push_back(this);
+    for (auto it = children_.cbegin(); it != children_.cend(); ++it) {
+        it->second->Flatten(list);
+    }
+}
+
+/**
+ * @brief returns the names of the fields written by @ref PackRaw, in order
+ */
+std::vector<std::string> TimerBlock::RawFields() {
+    return {"time", "count", "memsize", "wait", "minflt", "majflt", "nvcsw", "nivcsw", "rss", "read", "write"};
+}
+
+/**
+ * @brief packs the local accumulators of the block in data, in the order given by @ref RawFields
+ *
+ * @param data array of (at least) RawFields().size() doubles
+ */
+void TimerBlock::PackRaw(double* data) const {
+    data[0] = time_acc_;
+    data[1] = static_cast<double>(count_);
+    data[2] = static_cast<double>(memsize_);
+    data[3] = wait_acc_;
+    for (int ir = 0; ir < H3LPR_RES_N; ++ir) {
+        data[4 + ir] = res_acc_[ir];
+    }
+}
+
+/**
+ * @brief adds data to the local accumulators of the block
+ *
+ * @param data array of RawFields().size() doubles, in the same order as @ref PackRaw
+ */
+void TimerBlock::MergeRaw(const double* data) {
+    time_acc_ += data[0];
+    // the cost only measures the current run
+    time_rst_ += data[0];
+    count_ += static_cast<int>(data[1]);
+    memsize_ += static_cast<size_t>(data[2]);
+    wait_acc_ += data[3];
+    for (int ir = 0; ir < H3LPR_RES_N; ++ir) {
+        res_acc_[ir] += data[4 + ir];
+    }
+}
+
 //===============================================================================================================================
+/**
+ * @brief appends size bytes of data to the buffer
+ */
+static void AppendRaw(string* buffer, const void* data, const size_t size) {
+    buffer->append(reinterpret_cast<const char*>(data), size);
+}
+
+/**
+ * @brief appends a string to the buffer, as its length (int32) followed by the characters
+ */
+static void AppendRaw(string* buffer, const string& str) {
+    const int32_t len = static_cast<int32_t>(str.length());
+    AppendRaw(buffer, &len, sizeof(int32_t));
+    AppendRaw(buffer, str.data(), str.length());
+}
+
+//===============================================================================================================================
+static std::atomic<uint64_t> prof_counter(0);  //!< used to give a unique id to every profiler
+
 /**
  * @brief Construct a new Prof with a default name
  */
-Profiler::Profiler() : name_("default") {
+Profiler::Profiler() : name_("default"), uid_(prof_counter.fetch_add(1) + 1) {
     // create the current Timer Block "root"
     root_ = new TimerBlock("root");
     current_ = root_;
+    RegisterBlock_(root_);
 }
 
 /**
  * @brief Construct a new Prof with a given name
  */
-Profiler::Profiler(const string myname) : name_(myname) {
+Profiler::Profiler(const string myname) : name_(myname), uid_(prof_counter.fetch_add(1) + 1) {
     // create the current Timer Block "root"
     root_ = new TimerBlock("root");
     current_ = root_;
+    RegisterBlock_(root_);
 }
 
 /**
@@ -374,45 +649,471 @@ Profiler::~Profiler() {
         }
         m_log_h3lpr("WARNING: destroying profiler, but not all timers were stopped (remaining: %s)", remaining_blocks.c_str());
     }
+    delete shm_;
     delete root_;
 }
 
 /**
  * @brief initialize the timer and move to it + return the TimerBlock adress
  */
-void Profiler::Init(string name)  noexcept{
+void Profiler::Init(const string& name) noexcept {
     current_ = current_->AddChild(name);
+    if (current_->id() < 0) {
+        RegisterBlock_(current_);
+    }
 }
 
 /**
  * @brief start the timer of the TimerBlock
  */
-void Profiler::Start(string name) noexcept {
-    current_->Start();
+void Profiler::Start(const string& name) noexcept {
+    StartCurrent_();
+}
+
+/**
+ * @brief start the timer of the TimerBlock and measure the time spent in a barrier on comm
+ *
+ * The time spent in the barrier is the wait for the other ranks (load imbalance), it is included in the time of the block
+ * and reported separately by @ref Disp.
+ *
+ * @warning this call is collective on comm
+ */
+void Profiler::StartSync([[maybe_unused]] const string& name, MPI_Comm comm) noexcept {
+    StartCurrent_();
+    const double t_wait = MPI_Wtime();
+    MPI_Barrier(comm);
+    current_->AddWait(MPI_Wtime() - t_wait);
 }
 
 /**
  * @brief stop the timer of the TimerBlock using the given walltime
  */
-void Profiler::Stop(string name, const double wtime) noexcept {
+void Profiler::Stop(const string& name, const double wtime) noexcept {
     m_assert_h3lpr(name == current_->name(), "we are trying to stop %s which is not the most recent timer started = %s", name.c_str(), current_->name().c_str());
-    current_->Stop(wtime);
+    StopCurrent_(wtime);
 }
 
 /**
  * @brief go back to the parent of the present timer block
  */
-void Profiler::Leave(string name)noexcept  {
+void Profiler::Leave(const string& name) noexcept {
+    LeaveCurrent_();
+}
+
+/**
+ * @brief initialize and start the block of a call site, see @ref ScopedTimer
+ *
+ * The block is cached in the site, so that no lookup by name is done as long as the site is reached
+ * from the same parent block of the same profiler.
+ *
+ * @param site the call site
+ */
+void Profiler::Enter(ProfSite* site) noexcept {
+    if (site->prof_uid == uid_ && site->parent == current_) {
+        current_ = site->block;
+    } else {
+        Init(site->name);
+        site->prof_uid = uid_;
+        site->parent   = current_->parent();
+        site->block    = current_;
+    }
+    StartCurrent_();
+}
+
+/**
+ * @brief stop the block of a call site and go back to its parent, see @ref ScopedTimer
+ *
+ * @param site the call site
+ * @param wtime the stop time
+ */
+void Profiler::Exit(const ProfSite* site, const double wtime) noexcept {
+    m_assert_h3lpr(site->block == current_, "we are trying to stop %s which is not the most recent timer started = %s", site->name, current_->name().c_str());
+    StopCurrent_(wtime);
+    LeaveCurrent_();
+}
+
+/**
+ * @brief start the timer of the current block
+ */
+void Profiler::StartCurrent_() noexcept {
+    if (resource_) {
+        current_->StartResource();
+    }
+    current_->Start();
+    if (shm_ != nullptr) {
+        shm_->Start(current_->id());
+    }
+}
+
+/**
+ * @brief stop the timer of the current block using the given walltime
+ */
+void Profiler::StopCurrent_(const double wtime) noexcept {
+    if (trace_max_ > 0) {
+        if (trace_.size() < trace_max_) {
+            trace_.push_back({current_->id(), current_->t0(), wtime});
+        } else {
+            trace_drop_ += 1;
+        }
+    }
+    current_->Stop(wtime);
+    if (resource_) {
+        current_->StopResource();
+    }
+    if (shm_ != nullptr) {
+        shm_->Stop(current_->id(), current_->count(), current_->time_local(), current_->memsize());
+    }
+}
+
+/**
+ * @brief go back to the parent of the current block
+ */
+void Profiler::LeaveCurrent_() noexcept {
     current_ = current_->parent();
+    if (shm_ != nullptr) {
+        shm_->SetCurrent(current_->id());
+    }
+}
+
+/**
+ * @brief gives an id to a newly created block, adds it to the path index and mirrors it if needed
+ */
+void Profiler::RegisterBlock_(TimerBlock* block) {
+    block->SetId(nblock_);
+    nblock_ += 1;
+    time_map_[block->path()] = block;
+    if (shm_ != nullptr) {
+        const int parent_id = (block->parent() != nullptr) ? block->parent()->id() : -1;
+        if (!shm_->AddBlock(block->id(), parent_id, block->path()) && block->id() == shm_max_block) {
+            m_log_h3lpr("WARNING: only the first %d blocks are mirrored in shared memory", shm_max_block);
+        }
+    }
+}
+
+/**
+ * @brief mirrors the accumulators in a POSIX shared-memory segment, to be read by h3lpr-top
+ *
+ * The segment is named `/h3lpr.<name>.<rank>` and is updated at every start/stop of a timer, without any MPI call.
+ * It is removed when the profiler is destroyed.
+ */
+void Profiler::EnableShm() {
+    //--------------------------------------------------------------------------
+    if (shm_ != nullptr) {
+        return;
+    }
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    shm_ = new ShmWriter(name_, rank);
+    if (!shm_->is_valid()) {
+        m_log_h3lpr("WARNING: unable to create the shared-memory segment <%s>", shm_->name().c_str());
+        delete shm_;
+        shm_ = nullptr;
+        return;
+    }
+
+    // register the existing blocks with their current state
+    std::vector<const TimerBlock*> blocks;
+    root_->Flatten(&blocks);
+    for (const TimerBlock* block : blocks) {
+        const int parent_id = (block->parent() != nullptr) ? block->parent()->id() : -1;
+        if (shm_->AddBlock(block->id(), parent_id, block->path())) {
+            shm_->Stop(block->id(), block->count(), block->time_local(), block->memsize());
+        }
+    }
+    shm_->SetCurrent(current_->id());
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief returns the block associated to the name, nullptr if not found
+ *
+ * The name is either the name of a child of the current block or the path of a block in the tree (ex: root/step/substep).
+ * The children are searched first to keep the historical behavior, then the path index is used (O(1) lookup).
+ */
+TimerBlock* Profiler::FindBlock_(const string& name) const noexcept {
+    const auto it_child = current_->children().find(name);
+    if (it_child != current_->children().end()) {
+        return it_child->second;
+    }
+    const auto it_path = time_map_.find(name);
+    return (it_path != time_map_.end()) ? it_path->second : nullptr;
+}
+
+/**
+ * @brief returns true if the block exists, see @ref FindBlock_ for the possible names
+ */
+bool Profiler::HasBlock(const string& name) const noexcept {
+    return FindBlock_(name) != nullptr;
+}
+
+/**
+ * @brief returns the local elapsed time of a block
+ *
+ * @param name the name of a child of the current block or the path of a block (ex: root/step/substep)
+ */
+double Profiler::GetTime(const string& name) const noexcept {
+    const TimerBlock* block = FindBlock_(name);
+    m_assert_h3lpr(block != nullptr, "you requested the time of %s which is neither a child nor a path", name.c_str());
+    return block->time_acc();
+}
+
+/**
+ * @brief returns the local time spent waiting for the other ranks at the entry of a block, see @ref StartSync
+ *
+ * @param name the name of a child of the current block or the path of a block (ex: root/step/substep)
+ */
+double Profiler::GetWait(const string& name) const noexcept {
+    const TimerBlock* block = FindBlock_(name);
+    m_assert_h3lpr(block != nullptr, "you requested the wait of %s which is neither a child nor a path", name.c_str());
+    return block->wait_acc();
+}
+
+/**
+ * @brief returns the local number of calls of a block
+ *
+ * @param name the name of a child of the current block or the path of a block (ex: root/step/substep)
+ */
+int Profiler::GetCount(const string& name) const noexcept {
+    const TimerBlock* block = FindBlock_(name);
+    m_assert_h3lpr(block != nullptr, "you requested the count of %s which is neither a child nor a path", name.c_str());
+    return block->count();
+}
+
+/**
+ * @brief returns the local memory size associated to a block
+ *
+ * @param name the name of a child of the current block or the path of a block (ex: root/step/substep)
+ */
+size_t Profiler::GetMemsize(const string& name) const noexcept {
+    const TimerBlock* block = FindBlock_(name);
+    m_assert_h3lpr(block != nullptr, "you requested the memsize of %s which is neither a child nor a path", name.c_str());
+    return block->memsize();
+}
+
+/**
+ * @brief returns the time of a block reduced over the ranks of comm, using a single MPI_Allreduce
+ *
+ * A rank on which the block does not exist contributes with a time of 0.
+ *
+ * @warning this call is collective on comm
+ *
+ * @param name the name of a child of the current block or the path of a block (ex: root/step/substep)
+ * @param op the reduction operation (MPI_MAX, MPI_MIN, MPI_SUM)
+ * @param comm the communicator
+ */
+double Profiler::GetTimeReduced(const string& name, MPI_Op op, MPI_Comm comm) const noexcept {
+    const TimerBlock* block      = FindBlock_(name);
+    const double      local_time = (block != nullptr) ? block->time_acc() : 0.0;
+    double            red_time   = 0.0;
+    MPI_Allreduce(&local_time, &red_time, 1, MPI_DOUBLE, op, comm);
+    return red_time;
+}
+
+/**
+ * @brief returns the local time spent in a block since the last call to @ref ResetCost (0 if the block does not exist)
+ *
+ * If the block is running, the time elapsed since its start is included.
+ *
+ * @param name the name of a child of the current block or the path of a block (ex: root/step/substep)
+ */
+double Profiler::GetCost(const string& name) const noexcept {
+    const TimerBlock* block = FindBlock_(name);
+    return (block != nullptr) ? block->cost(MPI_Wtime()) : 0.0;
+}
+
+/**
+ * @brief resets the cost of a block, typically after a repartitioning, the accumulated time is not affected
+ *
+ * @param name the name of a child of the current block or the path of a block (ex: root/step/substep)
+ */
+void Profiler::ResetCost(const string& name) noexcept {
+    TimerBlock* block = FindBlock_(name);
+    if (block != nullptr) {
+        block->ResetCost(MPI_Wtime());
+    }
+}
+
+/**
+ * @brief gathers the cost of a block on every rank of comm using a single MPI_Allgather
+ *
+ * The returned vector (of size comm_size) is a reference to a buffer owned by the profiler,
+ * it remains valid (and unchanged) until the next call to GatherCost.
+ *
+ * @warning this call is collective on comm
+ *
+ * @param name the name of a child of the current block or the path of a block (ex: root/step/substep)
+ * @param comm the communicator
+ */
+const std::vector<double>& Profiler::GatherCost(const string& name, MPI_Comm comm) noexcept {
+    int comm_size;
+    MPI_Comm_size(comm, &comm_size);
+    cost_buffer_.resize(comm_size);
+
+    const double local_cost = GetCost(name);
+    MPI_Allgather(&local_cost, 1, MPI_DOUBLE, cost_buffer_.data(), 1, MPI_DOUBLE, comm);
+    return cost_buffer_;
+}
+
+/**
+ * @brief measures the offset between the local clock and the one of rank 0
+ *
+ * The offset is estimated by ping-pong with rank 0, keeping the exchange with the smallest round-trip time.
+ * Every call adds a sample, and the offset used by @ref GlobalTime is a linear fit of the samples,
+ * so calling it at the beginning and at the end of the run also corrects the drift of the clocks
+ * (the samples must be at least 1 second apart, otherwise the drift is not fitted).
+ * If MPI_WTIME_IS_GLOBAL is set, no message is exchanged and the offset is 0.
+ *
+ * @warning this call is collective on MPI_COMM_WORLD and scales linearly with the number of ranks
+ */
+void Profiler::SyncClock() {
+    //--------------------------------------------------------------------------
+    constexpr int n_pingpong = 16;
+
+    int comm_size, rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // no need to do anything if the clock is already global
+    int* is_global;
+    int  flag;
+    MPI_Comm_get_attr(MPI_COMM_WORLD, MPI_WTIME_IS_GLOBAL, &is_global, &flag);
+    if (flag && *is_global) {
+        clock_time_.push_back(MPI_Wtime());
+        clock_offset_.push_back(0.0);
+        return;
+    }
+
+    // use our own communicator to not interfere with the application's messages
+    MPI_Comm comm;
+    MPI_Comm_dup(MPI_COMM_WORLD, &comm);
+
+    double t_sample = MPI_Wtime();
+    double offset   = 0.0;
+    if (rank == 0) {
+        for (int ir = 1; ir < comm_size; ++ir) {
+            for (int ip = 0; ip < n_pingpong; ++ip) {
+                double t_ping;
+                MPI_Recv(&t_ping, 1, MPI_DOUBLE, ir, 0, comm, MPI_STATUS_IGNORE);
+                const double t_pong = MPI_Wtime();
+                MPI_Send(&t_pong, 1, MPI_DOUBLE, ir, 0, comm);
+            }
+        }
+    } else {
+        double min_rtt = std::numeric_limits<double>::max();
+        for (int ip = 0; ip < n_pingpong; ++ip) {
+            double       t_pong;
+            const double t_ping = MPI_Wtime();
+            MPI_Send(&t_ping, 1, MPI_DOUBLE, 0, 0, comm);
+            MPI_Recv(&t_pong, 1, MPI_DOUBLE, 0, 0, comm, MPI_STATUS_IGNORE);
+            const double t_back = MPI_Wtime();
+            // the pong has been sent by rank 0 in the middle of the exchange
+            if ((t_back - t_ping) < min_rtt) {
+                min_rtt  = t_back - t_ping;
+                t_sample = 0.5 * (t_ping + t_back);
+                offset   = t_pong - t_sample;
+            }
+        }
+        m_verb_h3lpr("clock offset = %e [s] with a round-trip time of %e [s]", offset, min_rtt);
+    }
+    MPI_Comm_free(&comm);
+
+    clock_time_.push_back(t_sample);
+    clock_offset_.push_back(offset);
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief converts a local time into the time of rank 0 using the samples measured by @ref SyncClock
+ *
+ * With one sample the offset is constant, with more samples the offset is the least-square linear fit (offset + drift).
+ * The drift is fitted only if the samples span at least clock_min_span: over a shorter time the slope is mostly the noise
+ * of the measures and is amplified far from the samples, the mean offset is then used.
+ *
+ * @param wtime the local time given by MPI_Wtime()
+ */
+double Profiler::GlobalTime(const double wtime) const noexcept {
+    //--------------------------------------------------------------------------
+    const size_t n_sample = clock_time_.size();
+    if (n_sample == 0) {
+        return wtime;
+    } else if (n_sample == 1) {
+        return wtime + clock_offset_[0];
+    }
+    // fit offset = a + b * (t - t_mean)
+    double t_mean = 0.0, o_mean = 0.0;
+    for (size_t is = 0; is < n_sample; ++is) {
+        t_mean += clock_time_[is] / n_sample;
+        o_mean += clock_offset_[is] / n_sample;
+    }
+    double s_to = 0.0, s_tt = 0.0;
+    for (size_t is = 0; is < n_sample; ++is) {
+        s_to += (clock_time_[is] - t_mean) * (clock_offset_[is] - o_mean);
+        s_tt += (clock_time_[is] - t_mean) * (clock_time_[is] - t_mean);
+    }
+    const auto   t_minmax = std::minmax_element(clock_time_.begin(), clock_time_.end());
+    const bool   is_fit   = (s_tt > 0.0) && ((*t_minmax.second - *t_minmax.first) >= clock_min_span);
+    const double drift    = (is_fit) ? (s_to / s_tt) : 0.0;
+    return wtime + o_mean + drift * (wtime - t_mean);
+    //--------------------------------------------------------------------------
 }
 
 /**
- * @brief returns the elapsed time for one of the children only
+ * @brief records the begin and end of every stopped block, up to max_event events
  *
- * @param name
+ * @param max_event the max number of events, the memory is reserved upfront
  */
-double Profiler::GetTime(string name) noexcept {
-    return current_->GetChildrenTime(name);
+void Profiler::EnableTrace(const size_t max_event) {
+    trace_max_ = max_event;
+    trace_.reserve(max_event);
+}
+
+/**
+ * @brief writes the recorded events of every rank to ./prof/name_trace.csv using collective MPI-IO
+ *
+ * The timestamps are converted to the clock of rank 0 using @ref GlobalTime so that the events of all the ranks
+ * can be merged on a single timeline. Each line reads `rank;path;t_begin;t_end`.
+ *
+ * @warning this call is collective on MPI_COMM_WORLD
+ */
+void Profiler::DumpTrace() {
+    //--------------------------------------------------------------------------
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // get the paths from the ids
+    std::vector<const TimerBlock*> blocks(nblock_, nullptr);
+    for (auto it = time_map_.cbegin(); it != time_map_.cend(); ++it) {
+        blocks[it->second->id()] = it->second;
+    }
+
+    string buffer = (rank == 0) ? "rank;path;t_begin;t_end\n" : "";
+    char   line[64];
+    for (const TraceEvent& event : trace_) {
+        std::snprintf(line, 64, ";%.9f;%.9f\n", GlobalTime(event.t0), GlobalTime(event.t1));
+        buffer += std::to_string(rank) + ";" + blocks[event.id]->path() + line;
+    }
+    if (trace_drop_ > 0) {
+        m_log_h3lpr("WARNING: %zu events have not been recorded in the trace", trace_drop_);
+    }
+
+    // get the offset of every rank
+    long local_size = buffer.size();
+    long offset     = 0;
+    MPI_Exscan(&local_size, &offset, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+    offset = (rank == 0) ? 0 : offset;
+
+    string   filename = "./prof/" + name_ + "_trace.csv";
+    MPI_File file;
+    int      err = MPI_File_open(MPI_COMM_WORLD, filename.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+    if (err == MPI_SUCCESS) {
+        MPI_File_set_size(file, 0);
+        MPI_File_write_at_all(file, offset, buffer.data(), static_cast<int>(buffer.size()), MPI_CHAR, MPI_STATUS_IGNORE);
+        MPI_File_close(&file);
+    } else {
+        m_log_h3lpr("unable to open file for tracing <%s>!", filename.c_str());
+    }
+    //--------------------------------------------------------------------------
 }
 
 /**
@@ -421,7 +1122,6 @@ double Profiler::GetTime(string name) noexcept {
 void Profiler::Disp() {
     // record current time
     const double wtime = MPI_Wtime();
-    const bool root_call = (current_ == root_);
 
     int comm_size, rank;
     MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
@@ -441,17 +1141,7 @@ void Profiler::Disp() {
 
     // Save current state, stop all running blocks, and retrieve the root
     std::stack<TimerBlock*> call_stack;
-    std::string stopped_string = "";
-    while (current_->parent() != nullptr) {
-        current_->Stop(wtime);
-        call_stack.push(current_);
-        stopped_string += current_->name() + ", ";
-        current_ = current_->parent();
-    }
-    m_assert_h3lpr(current_ == root_, "Current block should be the root block.");
-    if (!root_call) {
-        m_log_h3lpr("WARNING: displaying profiler, but not all timers were stopped (remaining: %s)", stopped_string.c_str());
-    }
+    StopAll_(wtime, &call_stack);
 
     // get the global timing
     double total_time = current_->time_acc();
@@ -490,13 +1180,283 @@ void Profiler::Disp() {
     }
 
     // Restart all the stopped blocks to restore the old state
-    while (!call_stack.empty()) {
-        current_ = call_stack.top();
+    ResumeAll_(&call_stack);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+/**
+ * @brief writes the raw accumulators of every block and every rank to ./prof/name_raw.bin, see @ref Save
+ *
+ * Contrarily to @ref Disp, no reduction is performed so that the full distribution over the ranks can be analyzed offline.
+ */
+void Profiler::DumpRaw() {
+    Save("./prof/" + name_ + "_raw.bin");
+}
+
+/**
+ * @brief writes the raw accumulators of every block and every rank to a single file using collective MPI-IO
+ *
+ * The file is made of
+ * - a header, written by rank 0:
+ *      - `char[8]` the magic string "H3LPRRAW"
+ *      - `int32` the version of the format, the number of ranks, the number of blocks and the number of fields
+ *      - for each field: `int32` the length of the name, followed by the name
+ *      - for each block: `int32` the length of the path, followed by the path (ex: root/step/substep)
+ *      - some padding to align the header on 8 bytes
+ * - for each rank (in order): nblock x nfield `double` with the fields of every block, block after block
+ *
+ * The file can be read back using @ref Load, typically to continue the profiling after a restart.
+ *
+ * @warning like for @ref Disp, the tree of blocks must be the same on every rank
+ *
+ * @param filename the name of the file
+ */
+void Profiler::Save(const string& filename) {
+    // record current time
+    const double wtime = MPI_Wtime();
+
+    int comm_size, rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // stop the running blocks to account for the current time
+    std::stack<TimerBlock*> call_stack;
+    StopAll_(wtime, &call_stack);
+
+    //-------------------------------------------------------------------------
+    /** - get the list of blocks, the order is the same on every rank */
+    //-------------------------------------------------------------------------
+    std::vector<const TimerBlock*> blocks;
+    root_->Flatten(&blocks);
+    const std::vector<string> fields = TimerBlock::RawFields();
+
+    const int32_t nblock = static_cast<int32_t>(blocks.size());
+    const int32_t nfield = static_cast<int32_t>(fields.size());
+
+    //-------------------------------------------------------------------------
+    /** - build the header, every rank needs its size */
+    //-------------------------------------------------------------------------
+    const char    magic[8]  = {'H', '3', 'L', 'P', 'R', 'R', 'A', 'W'};
+    const int32_t version   = 1;
+    const int32_t nrank_i32 = static_cast<int32_t>(comm_size);
+
+    string header;
+    AppendRaw(&header, magic, 8);
+    AppendRaw(&header, &version, sizeof(int32_t));
+    AppendRaw(&header, &nrank_i32, sizeof(int32_t));
+    AppendRaw(&header, &nblock, sizeof(int32_t));
+    AppendRaw(&header, &nfield, sizeof(int32_t));
+    for (const string& field : fields) {
+        AppendRaw(&header, field);
+    }
+    for (const TimerBlock* block : blocks) {
+        AppendRaw(&header, block->path());
+    }
+    header.append((sizeof(double) - header.size() % sizeof(double)) % sizeof(double), '\0');
+
+#if (M_DEBUG)
+    long header_size     = header.size();
+    long header_size_max = 0;
+    MPI_Allreduce(&header_size, &header_size_max, 1, MPI_LONG, MPI_MAX, MPI_COMM_WORLD);
+    m_assert_h3lpr(header_size == header_size_max, "the header size = %ld does not match the max one = %ld, the trees must be the same on every rank", header_size, header_size_max);
+#endif
+
+    //-------------------------------------------------------------------------
+    /** - pack the local data */
+    //-------------------------------------------------------------------------
+    std::vector<double> data(static_cast<size_t>(nblock) * nfield);
+    for (int32_t ib = 0; ib < nblock; ++ib) {
+        blocks[ib]->PackRaw(data.data() + static_cast<size_t>(ib) * nfield);
+    }
+
+    //-------------------------------------------------------------------------
+    /** - do the IO */
+    //-------------------------------------------------------------------------
+    MPI_File file;
+    int      err = MPI_File_open(MPI_COMM_WORLD, filename.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+    if (err == MPI_SUCCESS) {
+        MPI_File_set_size(file, 0);
+
+        // the header is written by rank 0 only
+        const int header_count = (rank == 0) ? static_cast<int>(header.size()) : 0;
+        MPI_File_write_at_all(file, 0, header.data(), header_count, MPI_CHAR, MPI_STATUS_IGNORE);
+
+        // every rank writes its own chunk
+        const MPI_Offset offset = static_cast<MPI_Offset>(header.size()) + static_cast<MPI_Offset>(rank) * data.size() * sizeof(double);
+        MPI_File_write_at_all(file, offset, data.data(), static_cast<int>(data.size()), MPI_DOUBLE, MPI_STATUS_IGNORE);
+        MPI_File_close(&file);
+    } else {
+        m_log_h3lpr("unable to open file for raw profiling <%s>!", filename.c_str());
+    }
+
+    // Restart all the stopped blocks to restore the old state
+    ResumeAll_(&call_stack);
+}
+
+/**
+ * @brief reads a file written by @ref Save and adds the accumulators to the ones of the current profiler
+ *
+ * The blocks are created if needed and the fields are matched by name, a field missing from the file is left untouched.
+ * Rank i reads the data written by rank i, if the number of ranks has changed, the extra ranks do not load anything.
+ * A file that is not a valid profiler file (truncated, other format) is ignored with an error message on every rank.
+ * The loaded time is not included in the cost of the blocks (see @ref GetCost).
+ *
+ * @warning this call is collective on MPI_COMM_WORLD, and must be done outside of any block
+ *
+ * @param filename the name of the file
+ */
+void Profiler::Load(const string& filename) {
+    //--------------------------------------------------------------------------
+    m_assert_h3lpr(current_ == root_, "the profiler must be loaded outside of any block, current = %s", current_->name().c_str());
+
+    int comm_size, rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    MPI_File file;
+    int      err = MPI_File_open(MPI_COMM_WORLD, filename.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file);
+    if (err != MPI_SUCCESS) {
+        m_log_h3lpr("unable to open file for loading the profiler <%s>!", filename.c_str());
+        return;
+    }
+
+    //-------------------------------------------------------------------------
+    /** - rank 0 reads the header and broadcasts it */
+    //-------------------------------------------------------------------------
+    int32_t info[4] = {0, 0, 0, 0};  // version, nrank, nblock, nfield
+    long    header_size = 0;
+    string  header;
+    if (rank == 0) {
+        char       magic[8] = {0};
+        MPI_Offset file_size;
+        MPI_File_get_size(file, &file_size);
+        const long min_size = 8 + 4 * sizeof(int32_t);
+        if (file_size >= min_size) {
+            MPI_File_read_at(file, 0, magic, 8, MPI_CHAR, MPI_STATUS_IGNORE);
+            MPI_File_read_at(file, 8, info, 4, MPI_INT32_T, MPI_STATUS_IGNORE);
+        }
+        // the header is what is left once the data is removed, a truncated or foreign file is rejected (header_size = 0)
+        const bool is_valid = (file_size >= min_size) && (strncmp(magic, "H3LPRRAW", 8) == 0) && (info[0] == 1) &&
+                              (info[1] > 0) && (info[2] >= 0) && (info[3] >= 0);
+        if (is_valid) {
+            header_size = static_cast<long>(file_size) - static_cast<long>(info[1]) * info[2] * info[3] * static_cast<long>(sizeof(double));
+        }
+        if (header_size < min_size || header_size > static_cast<long>(file_size)) {
+            header_size = 0;
+        } else {
+            header.resize(header_size);
+            MPI_File_read_at(file, 0, &header[0], static_cast<int>(header_size), MPI_CHAR, MPI_STATUS_IGNORE);
+        }
+    }
+    MPI_Bcast(&header_size, 1, MPI_LONG, 0, MPI_COMM_WORLD);
+    if (header_size == 0) {
+        m_log_h3lpr("ERROR: the file <%s> is not a valid profiler file, nothing is loaded", filename.c_str());
+        MPI_File_close(&file);
+        return;
+    }
+    MPI_Bcast(info, 4, MPI_INT32_T, 0, MPI_COMM_WORLD);
+    header.resize(header_size);
+    MPI_Bcast(&header[0], static_cast<int>(header_size), MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    const int32_t nrank  = info[1];
+    const int32_t nblock = info[2];
+    const int32_t nfield = info[3];
+    if (nrank != comm_size) {
+        m_log_h3lpr("WARNING: the profiler has been saved with %d ranks and is loaded with %d ranks", nrank, comm_size);
+    }
+
+    //-------------------------------------------------------------------------
+    /** - read the fields and the blocks, create the blocks if needed */
+    //-------------------------------------------------------------------------
+    size_t pos        = 8 + 4 * sizeof(int32_t);
+    auto   ReadString = [&header, &pos]() -> string {
+        int32_t len;
+        std::memcpy(&len, header.data() + pos, sizeof(int32_t));
+        string str = header.substr(pos + sizeof(int32_t), len);
+        pos += sizeof(int32_t) + len;
+        return str;
+    };
+
+    // get the position of our fields in the file
+    const std::vector<string> fields = TimerBlock::RawFields();
+    std::vector<int>          field_id(fields.size(), -1);
+    for (int32_t ifield = 0; ifield < nfield; ++ifield) {
+        const string name = ReadString();
+        for (size_t id = 0; id < fields.size(); ++id) {
+            field_id[id] = (fields[id] == name) ? ifield : field_id[id];
+        }
+    }
+
+    std::vector<TimerBlock*> blocks(nblock);
+    for (int32_t ib = 0; ib < nblock; ++ib) {
+        const string path  = ReadString();
+        TimerBlock*  block = root_;
+        // skip the root and create the path
+        size_t start = path.find('/');
+        while (start != string::npos) {
+            const size_t end  = path.find('/', start + 1);
+            const string name = path.substr(start + 1, (end == string::npos) ? string::npos : (end - start - 1));
+            block             = block->AddChild(name);
+            if (block->id() < 0) {
+                RegisterBlock_(block);
+            }
+            start = end;
+        }
+        blocks[ib] = block;
+    }
+
+    //-------------------------------------------------------------------------
+    /** - read our data and add it to the blocks */
+    //-------------------------------------------------------------------------
+    const bool          do_read = (rank < nrank);
+    std::vector<double> data((do_read) ? (static_cast<size_t>(nblock) * nfield) : 0);
+    const MPI_Offset    offset = static_cast<MPI_Offset>(header_size) + static_cast<MPI_Offset>(rank) * nblock * nfield * sizeof(double);
+    MPI_File_read_at_all(file, (do_read) ? offset : 0, data.data(), static_cast<int>(data.size()), MPI_DOUBLE, MPI_STATUS_IGNORE);
+    MPI_File_close(&file);
+
+    if (do_read) {
+        std::vector<double> block_data(fields.size());
+        for (int32_t ib = 0; ib < nblock; ++ib) {
+            for (size_t id = 0; id < fields.size(); ++id) {
+                block_data[id] = (field_id[id] >= 0) ? data[static_cast<size_t>(ib) * nfield + field_id[id]] : 0.0;
+            }
+            blocks[ib]->MergeRaw(block_data.data());
+        }
+    }
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief stops all the running blocks using the given wtime and move back to the root
+ *
+ * @param wtime the time used to stop the blocks
+ * @param call_stack the stack of stopped blocks, to be given to @ref ResumeAll_
+ */
+void Profiler::StopAll_(const double wtime, std::stack<TimerBlock*>* call_stack) {
+    const bool  root_call      = (current_ == root_);
+    std::string stopped_string = "";
+    while (current_->parent() != nullptr) {
+        current_->Stop(wtime);
+        call_stack->push(current_);
+        stopped_string += current_->name() + ", ";
+        current_ = current_->parent();
+    }
+    m_assert_h3lpr(current_ == root_, "Current block should be the root block.");
+    if (!root_call) {
+        m_log_h3lpr("WARNING: accessing the profiler, but not all timers were stopped (remaining: %s)", stopped_string.c_str());
+    }
+}
+
+/**
+ * @brief resumes all the blocks stopped by @ref StopAll_ to restore the old state
+ */
+void Profiler::ResumeAll_(std::stack<TimerBlock*>* call_stack) {
+    while (!call_stack->empty()) {
+        current_ = call_stack->top();
         current_->Resume();
-        call_stack.pop();
+        call_stack->pop();
     }
-    
-    MPI_Barrier(MPI_COMM_WORLD);
 }
 
 }; // namespace H3LPR
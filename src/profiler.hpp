@@ -13,12 +13,17 @@
 
 // cpp headers
 #include <cmath>
+#include <cstdint>
 #include <iostream>
 #include <list>
 #include <map>
+#include <stack>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "macros.hpp"
+#include "profiler_shm.hpp"
 
 #ifdef COLOR_PROF
 #define M_COLOR_PROF 1
@@ -33,16 +38,54 @@
 #define M_NO_PROFILER 0
 #endif
 
+// measure the time spent waiting for the other ranks at the entry of the synchronizing blocks
+#ifdef WAIT_PROF
+#define M_WAIT_PROF 1
+#else
+#define M_WAIT_PROF 0
+#endif
+
 namespace H3LPR {
 
+/**
+ * @brief process resource counters accumulated by the blocks, see SampleResource()
+ */
+typedef enum Resource_t {
+    H3LPR_RES_MINFLT,  //!< minor page faults
+    H3LPR_RES_MAJFLT,  //!< major page faults
+    H3LPR_RES_NVCSW,   //!< voluntary context switches
+    H3LPR_RES_NIVCSW,  //!< involuntary context switches
+    H3LPR_RES_RSS,     //!< resident set size [B]
+    H3LPR_RES_READ,    //!< bytes read by the process [B]
+    H3LPR_RES_WRITE,   //!< bytes written by the process [B]
+    H3LPR_RES_N
+} Resource_t;
+
+void SampleResource(double res[H3LPR_RES_N]);
+
+/**
+ * @brief begin and end of a block, recorded by the Profiler when the trace is enabled
+ */
+struct TraceEvent {
+    int    id;  //!< the id of the block
+    double t0;  //!< local start time
+    double t1;  //!< local stop time
+};
+
 class TimerBlock {
    protected:
-    int         count_    = 0;         //!< the number of times this block has been called
-    size_t      memsize_  = 0;         //!< the memory size associated with a memory operation
-    double      t0_       = -1.0;      //!< temp start time of the block
-    double      t1_       = -1.0;      //!< temp stop time of the block
-    double      time_acc_ = 0.0;       //!< accumulator to add the time accumulation
-    std::string name_     = "noname";  //!< the default name of the block
+    int         id_                   = -1;        //!< the id of the block in the profiler, -1 if not registered
+    int         count_                = 0;         //!< the number of times this block has been called
+    size_t      memsize_              = 0;         //!< the memory size associated with a memory operation
+    double      t0_                   = -1.0;      //!< temp start time of the block
+    double      t1_                   = -1.0;      //!< temp stop time of the block
+    double      time_acc_             = 0.0;       //!< accumulator to add the time accumulation
+    double      time_rst_             = 0.0;       //!< value of the accumulator at the last reset of the cost
+    double      wait_acc_             = 0.0;       //!< time spent waiting for the other ranks at the entry of the block (included in time_acc_)
+    double      res_t0_[H3LPR_RES_N]  = {0.0};     //!< resource counters at the start of the block
+    double      res_acc_[H3LPR_RES_N] = {0.0};     //!< accumulated resource counters
+    std::string name_                 = "noname";  //!< the default name of the block
+    std::string path_                 = "noname";  //!< the full path of the block in the tree, i.e. root/step/substep
 
     TimerBlock* parent_ = nullptr;  //!< the link to the parent blocks
 
@@ -55,16 +98,51 @@ class TimerBlock {
     void Start();
     void Stop(const double time);
     void Resume();
+    void StartResource();
+    void StopResource();
 
     std::string name() const { return name_; }
+    std::string path() const { return path_; }
     TimerBlock* parent() const { return parent_; }
+    int         id() const { return id_; }
+    int         count() const { return count_; }
+    double      t0() const { return t0_; }
+    size_t      memsize() const { return memsize_; }
+    double      time_local() const { return time_acc_; }
+    double      wait_acc() const { return wait_acc_; }
+    double      res_acc(const Resource_t res) const { return res_acc_[res]; }
     double      time_acc() const;
+    double      cost(const double wtime) const;
+    void        ResetCost(const double wtime);
+
+    const std::map<std::string, TimerBlock*>& children() const { return children_; }
     TimerBlock* AddChild(std::string child_name) noexcept;
 
     double GetChildrenTime(std::string child_name) noexcept;
 
     void SetParent(TimerBlock* parent);
+    void SetId(const int id) { id_ = id; }
+    void AddWait(const double wait) { wait_acc_ += wait; }
     void Disp(FILE* file, const int level, const double totalTime, const int icol) const;
+
+    void Flatten(std::vector<const TimerBlock*>* list) const;
+
+    static std::vector<std::string> RawFields();
+    void                            PackRaw(double* data) const;
+    void                            MergeRaw(const double* data);
+};
+
+/**
+ * @brief cache of the block associated to a call site of @ref m_profScope
+ *
+ * The cache is valid if the site is reached from the same parent block of the same profiler.
+ * A site reached alternately from different profilers or parents stays correct but is refilled (one lookup by name) at every change.
+ */
+struct ProfSite {
+    const char* name;                //!< the name of the block, must be a string literal
+    uint64_t    prof_uid = 0;        //!< the unique id of the profiler that filled the cache (0 = empty)
+    TimerBlock* parent   = nullptr;  //!< the parent block
+    TimerBlock* block    = nullptr;  //!< the cached block
 };
 
 /**
@@ -77,29 +155,152 @@ class TimerBlock {
  */
 class Profiler {
    protected:
-    std::map<std::string, TimerBlock*> time_map_;
+    std::unordered_map<std::string, TimerBlock*> time_map_;  //!< index of all the blocks, using their path as key
 
     TimerBlock*       root_;     //!< this is a pointer to root TimerBlock
     TimerBlock*       current_;  //!< this is a pointer to the last TimerBlock
     const std::string name_;
+    const uint64_t    uid_;  //!< unique id of the profiler, used to validate the ProfSite caches
+
+    int        nblock_ = 0;        //!< the number of blocks registered, used to give an id to the blocks
+    ShmWriter* shm_    = nullptr;  //!< the shared-memory mirror of the profiler, nullptr if disabled
+
+    std::vector<double> cost_buffer_;  //!< persistent buffer filled by GatherCost
+
+    std::vector<double>     clock_time_;      //!< local times at which the clock offset has been measured
+    std::vector<double>     clock_offset_;    //!< measured offsets to the clock of rank 0
+    std::vector<TraceEvent> trace_;           //!< the recorded events
+    size_t                  trace_max_  = 0;  //!< max number of events recorded, 0 if the trace is disabled
+    size_t                  trace_drop_ = 0;  //!< number of events that have not been recorded
+
+    bool resource_ = false;  //!< true if the resource counters are measured
 
    public:
     explicit Profiler();
     explicit Profiler(const std::string myname);
     ~Profiler();
 
-    void Init(std::string name) noexcept;
-    void Start(std::string name) noexcept;
-    void Stop(std::string name, const double wtime) noexcept;
-    void Leave(std::string name) noexcept;
+    void Init(const std::string& name) noexcept;
+    void Start(const std::string& name) noexcept;
+    void StartSync(const std::string& name, MPI_Comm comm) noexcept;
+    void Stop(const std::string& name, const double wtime) noexcept;
+    void Leave(const std::string& name) noexcept;
+
+    void Enter(ProfSite* site) noexcept;
+    void Exit(const ProfSite* site, const double wtime) noexcept;
 
-    double GetTime(std::string name) noexcept;
+    bool   HasBlock(const std::string& name) const noexcept;
+    double GetTime(const std::string& name) const noexcept;
+    double GetWait(const std::string& name) const noexcept;
+    int    GetCount(const std::string& name) const noexcept;
+    double GetResource(const std::string& name, const Resource_t res) const noexcept;
+    size_t GetMemsize(const std::string& name) const noexcept;
+    double GetTimeReduced(const std::string& name, MPI_Op op = MPI_MAX, MPI_Comm comm = MPI_COMM_WORLD) const noexcept;
+
+    double                     GetCost(const std::string& name) const noexcept;
+    void                       ResetCost(const std::string& name) noexcept;
+    const std::vector<double>& GatherCost(const std::string& name, MPI_Comm comm = MPI_COMM_WORLD) noexcept;
 
     void Disp();
+    void DumpRaw();
+    void Save(const std::string& filename);
+    void Load(const std::string& filename);
+
+    void EnableShm();
+    void EnableResource() { resource_ = true; }
+
+    void   SyncClock();
+    double GlobalTime(const double wtime) const noexcept;
+    void   EnableTrace(const size_t max_event);
+    void   DumpTrace();
+
+   protected:
+    void        StartCurrent_() noexcept;
+    void        StopCurrent_(const double wtime) noexcept;
+    void        LeaveCurrent_() noexcept;
+    void        RegisterBlock_(TimerBlock* block);
+    TimerBlock* FindBlock_(const std::string& name) const noexcept;
+    void StopAll_(const double wtime, std::stack<TimerBlock*>* call_stack);
+    void ResumeAll_(std::stack<TimerBlock*>* call_stack);
+};
+
+//==============================================================================
+/**
+ * @brief RAII timer: the block is started at construction and stopped at destruction (including early returns and exceptions)
+ *
+ * The state is known at compile time, ScopedTimer<false> does nothing and is optimized away.
+ * The static functions Begin and End are used by the manually paired macros @ref m_profStart and @ref m_profStop.
+ *
+ * @tparam ENABLED true if the profiling is enabled
+ */
+template <bool ENABLED>
+class ScopedTimer;
+
+template <>
+class ScopedTimer<false> {
+   public:
+    explicit ScopedTimer(Profiler*, ProfSite*) noexcept {};
+    static void Begin(Profiler*, const std::string&) noexcept {};
+    static void End(Profiler*, const std::string&, const double) noexcept {};
+};
+
+template <>
+class ScopedTimer<true> {
+    Profiler*       prof_;
+    const ProfSite* site_;
+
+   public:
+    explicit ScopedTimer(Profiler* prof, ProfSite* site) noexcept : prof_(prof), site_(site) {
+        if (prof_ != nullptr) {
+            prof_->Enter(site);
+        }
+    };
+    ~ScopedTimer() {
+        if (prof_ != nullptr) {
+            const double wtime = MPI_Wtime();
+            prof_->Exit(site_, wtime);
+        }
+    };
+    ScopedTimer(const ScopedTimer&)            = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    static void Begin(Profiler* prof, const std::string& name) noexcept {
+        if (prof != nullptr) {
+            prof->Init(name);
+            prof->Start(name);
+        }
+    };
+    static void End(Profiler* prof, const std::string& name, const double wtime) noexcept {
+        if (prof != nullptr) {
+            prof->Stop(name, wtime);
+            prof->Leave(name);
+        }
+    };
 };
 
 };  // namespace H3LPR
 
+#define M_PROF_CONCAT_(a, b) a##b
+#define M_PROF_CONCAT(a, b)  M_PROF_CONCAT_(a, b)
+
+/**
+ * @brief times the current scope, name must be a string literal
+ *
+ * The block is looked up once per call site and per thread, and stopped when leaving the scope.
+ * The site is thread_local so that threads using their own profiler don't share the cache,
+ * a given profiler must still be used by one thread at a time.
+ * Without the profiler, nothing is declared.
+ */
+#if (M_NO_PROFILER)
+#define m_profScope(prof, name) \
+    { ((void)(prof)); }
+#else
+#define m_profScope(prof, name)                                                           \
+    static thread_local H3LPR::ProfSite M_PROF_CONCAT(m_profScope_site_, __LINE__){name}; \
+    H3LPR::ScopedTimer<true> M_PROF_CONCAT(m_profScope_timer_, __LINE__)(                 \
+        (H3LPR::Profiler*)(prof), &M_PROF_CONCAT(m_profScope_site_, __LINE__))
+#endif
+
 #if (M_NO_PROFILER)
 #define m_profInit(prof, name) \
     { ((void)0); }
@@ -147,14 +348,36 @@ class Profiler {
 #define m_profStart(prof, name) \
     { ((void)0); }
 #else
-#define m_profStart(prof, name)                                        \
-    ({                                                                 \
-        H3LPR::Profiler* m_profStart_prof_ = (H3LPR::Profiler*)(prof); \
-        std::string      m_profStart_name_ = (std::string)(name);      \
-        if ((m_profStart_prof_) != nullptr) {                          \
-            (m_profStart_prof_)->Init(m_profStart_name_);              \
-            (m_profStart_prof_)->Start(m_profStart_name_);             \
-        }                                                              \
+#define m_profStart(prof, name)                                                         \
+    ({                                                                                  \
+        H3LPR::ScopedTimer<true>::Begin((H3LPR::Profiler*)(prof), (std::string)(name)); \
+    })
+#endif
+
+/**
+ * @brief starts a block that ends with a collective on comm
+ *
+ * If compiled with WAIT_PROF, a timed barrier is inserted at the entry of the block
+ * to split its time into the wait for the other ranks (load imbalance) and the actual work/communication.
+ * If not, it is equivalent to @ref m_profStart
+ */
+#if (M_NO_PROFILER)
+#define m_profStartSync(prof, name, comm) \
+    { ((void)0); }
+#elif (M_WAIT_PROF)
+#define m_profStartSync(prof, name, comm)                                    \
+    ({                                                                       \
+        H3LPR::Profiler* m_profStartSync_prof_ = (H3LPR::Profiler*)(prof);   \
+        std::string      m_profStartSync_name_ = (std::string)(name);        \
+        if ((m_profStartSync_prof_) != nullptr) {                            \
+            (m_profStartSync_prof_)->Init(m_profStartSync_name_);            \
+            (m_profStartSync_prof_)->StartSync(m_profStartSync_name_, comm); \
+        }                                                                    \
+    })
+#else
+#define m_profStartSync(prof, name, comm) \
+    ({                                    \
+        m_profStart(prof, name);          \
     })
 #endif
 
@@ -162,15 +385,10 @@ class Profiler {
 #define m_profStop(prof, name) \
     { ((void)0); }
 #else
-#define m_profStop(prof, name)                                           \
-    ({                                                                   \
-        double           m_profStop_time  = MPI_Wtime();                 \
-        H3LPR::Profiler* m_profStop_prof_ = (H3LPR::Profiler*)(prof);    \
-        std::string      m_profStop_name_ = (std::string)(name);         \
-        if ((m_profStop_prof_) != nullptr) {                             \
-            (m_profStop_prof_)->Stop(m_profStop_name_, m_profStop_time); \
-            (m_profStop_prof_)->Leave(m_profStop_name_);                 \
-        }                                                                \
+#define m_profStop(prof, name)                                                                         \
+    ({                                                                                                 \
+        double m_profStop_time = MPI_Wtime();                                                          \
+        H3LPR::ScopedTimer<true>::End((H3LPR::Profiler*)(prof), (std::string)(name), m_profStop_time); \
     })
 #endif
 
@@ -216,4 +434,17 @@ class Profiler {
     })
 #endif
 
+#if (M_NO_PROFILER)
+#define m_profDumpRaw(prof) \
+    { ((void)0); }
+#else
+#define m_profDumpRaw(prof)                                              \
+    ({                                                                   \
+        H3LPR::Profiler* m_profDumpRaw_prof_ = (H3LPR::Profiler*)(prof); \
+        if ((m_profDumpRaw_prof_) != nullptr) {                          \
+            (m_profDumpRaw_prof_)->DumpRaw();                            \
+        }                                                                \
+    })
+#endif
+
 #endif  // SRC_PROF_HPP_
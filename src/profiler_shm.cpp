@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) Massachusetts Institute of Technology
+ *
+ * See LICENSE in top-level directory
+ */
+#include "profiler_shm.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+using std::string;
+
+namespace H3LPR {
+
+/**
+ * @brief returns the time given by CLOCK_MONOTONIC, which is shared by all the processes on the node
+ */
+double ShmMonoTime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<double>(ts.tv_sec) + 1e-9 * static_cast<double>(ts.tv_nsec);
+}
+
+/**
+ * @brief creates (or replaces) the segment /h3lpr.name.rank and initializes the layout
+ *
+ * If the creation fails, the writer is invalid and nothing is mirrored.
+ *
+ * @param prof_name the name of the profiler, non-alphanumeric characters are replaced by '_'
+ * @param rank the rank of the writer
+ */
+ShmWriter::ShmWriter(const string& prof_name, const int rank) {
+    //--------------------------------------------------------------------------
+    string clean_name = prof_name;
+    for (char& c : clean_name) {
+        c = (std::isalnum(static_cast<unsigned char>(c))) ? c : '_';
+    }
+    name_ = "/h3lpr." + clean_name + "." + std::to_string(rank);
+
+    const int fd = shm_open(name_.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    if (ftruncate(fd, sizeof(ShmLayout)) != 0) {
+        close(fd);
+        shm_unlink(name_.c_str());
+        return;
+    }
+    void* addr = mmap(nullptr, sizeof(ShmLayout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        shm_unlink(name_.c_str());
+        return;
+    }
+
+    // the segment is zero-initialized by ftruncate
+    layout_                   = reinterpret_cast<ShmLayout*>(addr);
+    layout_->header.version   = shm_version;
+    layout_->header.rank      = rank;
+    layout_->header.pid       = static_cast<int32_t>(getpid());
+    layout_->header.nblock    = 0;
+    layout_->header.current   = -1;
+    layout_->header.t_created = ShmMonoTime();
+    layout_->header.t_mono    = layout_->header.t_created;
+    // the magic number is written last so that a reader never sees a partial header
+    __atomic_store_n(&layout_->header.magic, shm_magic, __ATOMIC_RELEASE);
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief unmaps and removes the segment
+ */
+ShmWriter::~ShmWriter() {
+    //--------------------------------------------------------------------------
+    if (layout_ != nullptr) {
+        munmap(layout_, sizeof(ShmLayout));
+        shm_unlink(name_.c_str());
+    }
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief registers a new block, returns false if the block cannot be mirrored
+ *
+ * @param id the id of the block, must be < shm_max_block
+ * @param parent_id the id of the parent block (-1 for the root)
+ * @param path the path of the block (truncated if too long)
+ */
+bool ShmWriter::AddBlock(const int id, const int parent_id, const string& path) {
+    //--------------------------------------------------------------------------
+    if (layout_ == nullptr || id < 0 || id >= shm_max_block) {
+        return false;
+    }
+    BeginWrite_();
+    ShmBlock* block = layout_->block + id;
+    std::strncpy(block->path, path.c_str(), shm_max_path - 1);
+    block->path[shm_max_path - 1] = '\0';
+    block->parent                 = parent_id;
+    block->running                = 0;
+    block->count                  = 0.0;
+    block->time_acc               = 0.0;
+    block->memsize                = 0.0;
+    block->t0_mono                = -1.0;
+    layout_->header.nblock        = (id >= layout_->header.nblock) ? (id + 1) : layout_->header.nblock;
+    EndWrite_();
+    return true;
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief marks the block as running and make it the current one
+ */
+void ShmWriter::Start(const int id) {
+    //--------------------------------------------------------------------------
+    if (layout_ == nullptr || id < 0 || id >= layout_->header.nblock) {
+        return;
+    }
+    BeginWrite_();
+    layout_->block[id].running = 1;
+    layout_->block[id].t0_mono = layout_->header.t_mono;
+    layout_->header.current    = id;
+    EndWrite_();
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief updates the accumulators of the block and marks it as stopped
+ */
+void ShmWriter::Stop(const int id, const double count, const double time_acc, const double memsize) {
+    //--------------------------------------------------------------------------
+    if (layout_ == nullptr || id < 0 || id >= layout_->header.nblock) {
+        return;
+    }
+    BeginWrite_();
+    ShmBlock* block = layout_->block + id;
+    block->running  = 0;
+    block->count    = count;
+    block->time_acc = time_acc;
+    block->memsize  = memsize;
+    block->t0_mono  = -1.0;
+    EndWrite_();
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief sets the current block (top of the stack)
+ */
+void ShmWriter::SetCurrent(const int id) {
+    //--------------------------------------------------------------------------
+    if (layout_ == nullptr) {
+        return;
+    }
+    BeginWrite_();
+    layout_->header.current = (id < layout_->header.nblock) ? id : -1;
+    EndWrite_();
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief starts a write: seq becomes odd and the update time is refreshed
+ */
+void ShmWriter::BeginWrite_() {
+    const uint64_t seq = __atomic_load_n(&layout_->header.seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&layout_->header.seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    layout_->header.t_mono = ShmMonoTime();
+}
+
+/**
+ * @brief ends a write: seq becomes even again
+ */
+void ShmWriter::EndWrite_() {
+    const uint64_t seq = __atomic_load_n(&layout_->header.seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&layout_->header.seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief takes a consistent copy of the layout (reader side of the seqlock)
+ *
+ * @param layout the shared layout
+ * @param snapshot the copy
+ * @return true if the copy is consistent, false if the writer kept on updating the segment
+ */
+bool ShmSnapshot(const ShmLayout* layout, ShmLayout* snapshot) {
+    //--------------------------------------------------------------------------
+    if (__atomic_load_n(&layout->header.magic, __ATOMIC_ACQUIRE) != shm_magic) {
+        return false;
+    }
+    for (int itry = 0; itry < 1000; ++itry) {
+        const uint64_t seq_0 = __atomic_load_n(&layout->header.seq, __ATOMIC_ACQUIRE);
+        if (seq_0 % 2 == 1) {
+            continue;
+        }
+        std::memcpy(snapshot, layout, sizeof(ShmLayout));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        const uint64_t seq_1 = __atomic_load_n(&layout->header.seq, __ATOMIC_RELAXED);
+        if (seq_0 == seq_1) {
+            return true;
+        }
+    }
+    return false;
+    //--------------------------------------------------------------------------
+}
+
+};  // namespace H3LPR
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) Massachusetts Institute of Technology
+ *
+ * See LICENSE in top-level directory
+ */
+#ifndef H3LPR_SRC_PROFILER_SHM_HPP_
+#define H3LPR_SRC_PROFILER_SHM_HPP_
+
+// this header must stay free of MPI as it is used by the h3lpr-top reader
+
+#include <cstdint>
+#include <string>
+
+namespace H3LPR {
+
+constexpr uint32_t shm_magic     = 0x48334c50;  //!< "H3LP"
+constexpr uint32_t shm_version   = 1;           //!< version of the layout
+constexpr int      shm_max_block = 512;         //!< max number of blocks mirrored in the segment
+constexpr int      shm_max_path  = 192;         //!< max length of the path of a block (truncated if longer)
+
+/**
+ * @brief mirror of the accumulators of a TimerBlock
+ */
+struct ShmBlock {
+    char    path[shm_max_path];  //!< the path of the block, i.e. root/step/substep
+    int32_t parent;              //!< the id of the parent block, -1 for the root
+    int32_t running;             //!< 1 if the block is currently running
+    double  count;               //!< the number of times the block has been called
+    double  time_acc;            //!< accumulated time [s]
+    double  memsize;             //!< the memory size associated with the block
+    double  t0_mono;             //!< the monotonic time at which the block has been started [s]
+};
+
+/**
+ * @brief header of the segment, protected by a seqlock
+ *
+ * The writer increments seq before (odd value) and after (even value) any update.
+ * A reader copies the segment and retries if seq was odd or has changed during the copy.
+ */
+struct ShmHeader {
+    uint32_t magic;      //!< must be equal to shm_magic
+    uint32_t version;    //!< must be equal to shm_version
+    int32_t  rank;       //!< the rank in MPI_COMM_WORLD of the writer
+    int32_t  pid;        //!< the pid of the writer
+    uint64_t seq;        //!< sequence number of the seqlock, only accessed through atomic builtins
+    int32_t  nblock;     //!< the number of blocks registered
+    int32_t  current;    //!< the id of the current block (top of the stack)
+    double   t_mono;     //!< the monotonic time of the last update [s]
+    double   t_created;  //!< the monotonic time of the creation of the segment [s]
+};
+
+struct ShmLayout {
+    ShmHeader header;
+    ShmBlock  block[shm_max_block];
+};
+
+double ShmMonoTime();
+
+/**
+ * @brief Writes the profiler state in a POSIX shared-memory segment
+ *
+ * The segment is named `/h3lpr.<name>.<rank>` and is removed when the writer is destroyed.
+ * The writer is not thread-safe, only one thread must update the segment.
+ */
+class ShmWriter {
+   protected:
+    std::string name_;              //!< the name of the segment
+    ShmLayout*  layout_ = nullptr;  //!< the mapped layout, nullptr if the creation failed
+
+   public:
+    explicit ShmWriter(const std::string& prof_name, const int rank);
+    ~ShmWriter();
+
+    bool        is_valid() const { return layout_ != nullptr; }
+    std::string name() const { return name_; }
+
+    bool AddBlock(const int id, const int parent_id, const std::string& path);
+    void Start(const int id);
+    void Stop(const int id, const double count, const double time_acc, const double memsize);
+    void SetCurrent(const int id);
+
+   protected:
+    void BeginWrite_();
+    void EndWrite_();
+};
+
+bool ShmSnapshot(const ShmLayout* layout, ShmLayout* snapshot);
+
+};  // namespace H3LPR
+
+#endif  // H3LPR_SRC_PROFILER_SHM_HPP_
@@ -0,0 +1,540 @@
+/*
+ * Copyright (c) Massachusetts Institute of Technology
+ *
+ * See LICENSE in top-level directory
+ */
+#include "ptr.hpp"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace H3LPR {
+
+/**
+ * @brief initializes the memory
+ *
+ * With H3LPR_INIT_FIRSTTOUCH, the memory is split in contiguous chunks of equal size, one per OpenMP thread,
+ * as done by a `schedule(static)` loop. The pages are then placed on the NUMA node of the thread that uses them
+ * in a loop with the same schedule.
+ *
+ * @param ptr the memory
+ * @param size_byte the size of the memory
+ * @param init the initialization
+ */
+void InitMemory(void* ptr, const size_t size_byte, const Init_t init) {
+    //--------------------------------------------------------------------------
+    if (init == H3LPR_INIT_ZERO) {
+        std::memset(ptr, 0, size_byte);
+    } else if (init == H3LPR_INIT_FIRSTTOUCH) {
+#pragma omp parallel
+        {
+            const size_t n_thread = static_cast<size_t>(omp_get_num_threads());
+            const size_t i_thread = static_cast<size_t>(omp_get_thread_num());
+            const size_t chunk    = size_byte / n_thread;
+            const size_t rest     = size_byte % n_thread;
+            // same split as the static schedule: the first threads get one more byte
+            const size_t begin = i_thread * chunk + m_min(i_thread, rest);
+            const size_t end   = begin + chunk + ((i_thread < rest) ? 1 : 0);
+            std::memset(static_cast<char*>(ptr) + begin, 0, end - begin);
+        }
+    }
+    //--------------------------------------------------------------------------
+}
+
+//==============================================================================
+// NUMA PLACEMENT
+//==============================================================================
+// the constants of the memory policies (see numaif.h), libnuma is not needed
+static constexpr int h3lpr_mpol_preferred  = 1;
+static constexpr int h3lpr_mpol_bind       = 2;
+static constexpr int h3lpr_mpol_interleave = 3;
+static constexpr int h3lpr_mpol_local      = 4;
+
+static constexpr int h3lpr_numa_max_node = 64;  //!< max number of nodes supported (one unsigned long as mask)
+
+/**
+ * @brief returns the number of NUMA nodes of the system, 1 if unknown
+ */
+int NumaNodeCount() {
+    //--------------------------------------------------------------------------
+    static int n_node = -1;
+    if (n_node < 0) {
+        n_node = 0;
+        char path[64];
+        while (n_node < h3lpr_numa_max_node) {
+            snprintf(path, 64, "/sys/devices/system/node/node%d", n_node);
+            if (access(path, F_OK) != 0) {
+                break;
+            }
+            ++n_node;
+        }
+        n_node = m_max(n_node, 1);
+    }
+    return n_node;
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief calls mbind on the pages containing [ptr, ptr + size_byte[
+ */
+static bool NumaBind(void* ptr, const size_t size_byte, const int mode, const unsigned long mask) {
+    //--------------------------------------------------------------------------
+    const uintptr_t page  = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t first = reinterpret_cast<uintptr_t>(ptr) / page * page;
+    const uintptr_t last  = (reinterpret_cast<uintptr_t>(ptr) + size_byte + page - 1) / page * page;
+    if (last <= first) {
+        return true;
+    }
+    // the mask is ignored with MPOL_LOCAL
+    const unsigned long* nodemask = (mode == h3lpr_mpol_local) ? nullptr : &mask;
+    const unsigned long  maxnode  = (mode == h3lpr_mpol_local) ? 0 : (h3lpr_numa_max_node + 1);
+    return syscall(SYS_mbind, first, last - first, mode, nodemask, maxnode, 0) == 0;
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief returns the NUMA node of the calling thread, 0 if unknown
+ */
+static int NumaCurrentNode() {
+    unsigned cpu  = 0;
+    unsigned node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+        return 0;
+    }
+    return static_cast<int>(node);
+}
+
+/**
+ * @brief applies a NUMA policy to the memory, before it is touched
+ *
+ * The policy is applied using the mbind system call, on the pages that contain the memory (the pages are shared
+ * with the neighbouring memory if the memory is not aligned on the pages).
+ * If the system call fails (no NUMA support, forbidden in a container, etc) a warning is displayed once and the
+ * default policy is used.
+ *
+ * @param ptr the memory
+ * @param size_byte the size of the memory
+ * @param numa the policy
+ * @param numa_node the node used with H3LPR_NUMA_BIND
+ * @return true if the policy has been applied
+ */
+bool NumaPlace(void* ptr, const size_t size_byte, const Numa_t numa, const int numa_node) {
+    //--------------------------------------------------------------------------
+    static bool is_warned = false;
+    if (numa == H3LPR_NUMA_DEFAULT || ptr == nullptr || size_byte == 0) {
+        return true;
+    }
+    const int n_node = NumaNodeCount();
+    bool      is_ok  = true;
+    int       err    = 0;  // the errno of a failing OpenMP thread, errno is thread-local
+    if (numa == H3LPR_NUMA_LOCAL) {
+        is_ok = NumaBind(ptr, size_byte, h3lpr_mpol_local, 0);
+    } else if (numa == H3LPR_NUMA_INTERLEAVE) {
+        const unsigned long mask = (n_node >= h3lpr_numa_max_node) ? (~0ul) : ((1ul << n_node) - 1);
+        is_ok                    = NumaBind(ptr, size_byte, h3lpr_mpol_interleave, mask);
+    } else if (numa == H3LPR_NUMA_BIND) {
+        m_assert_h3lpr(0 <= numa_node && numa_node < n_node, "the node %d does not exist, there are %d nodes", numa_node, n_node);
+        is_ok = NumaBind(ptr, size_byte, h3lpr_mpol_bind, 1ul << numa_node);
+    } else if (numa == H3LPR_NUMA_CHUNKED) {
+        // every thread places its chunk, as a static schedule on the pages
+        const size_t page   = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t n_page = (size_byte + page - 1) / page;
+#pragma omp parallel reduction(&& : is_ok)
+        {
+            const size_t n_thread = static_cast<size_t>(omp_get_num_threads());
+            const size_t i_thread = static_cast<size_t>(omp_get_thread_num());
+            const size_t begin    = (n_page * i_thread) / n_thread;
+            const size_t end      = (n_page * (i_thread + 1)) / n_thread;
+            if (end > begin) {
+                char*        chunk = static_cast<char*>(ptr) + begin * page;
+                const size_t size  = m_min(end * page, size_byte) - begin * page;
+                if (!NumaBind(chunk, size, h3lpr_mpol_preferred, 1ul << NumaCurrentNode())) {
+                    is_ok = false;
+#pragma omp atomic write
+                    err = errno;
+                }
+            }
+        }
+    }
+    if (!is_ok && err == 0) {
+        err = errno;
+    }
+    if (!is_ok && !is_warned) {
+        is_warned = true;
+        m_log_h3lpr("WARNING: unable to apply the NUMA policy (%s), the default policy is used", strerror(err));
+    }
+    return is_ok;
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief counts the pages of the memory on each NUMA node, using the move_pages system call
+ *
+ * @param ptr the memory
+ * @param size_byte the size of the memory
+ * @param n_page the number of pages on each node (size NumaNodeCount())
+ * @param n_absent the number of pages that are not allocated yet (never touched)
+ * @return false if the query is not supported
+ */
+bool NumaPages(const void* ptr, const size_t size_byte, std::vector<size_t>* n_page, size_t* n_absent) {
+    //--------------------------------------------------------------------------
+    const uintptr_t page  = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t first = reinterpret_cast<uintptr_t>(ptr) / page * page;
+    const uintptr_t last  = (reinterpret_cast<uintptr_t>(ptr) + size_byte + page - 1) / page * page;
+    const size_t    count = (last - first) / page;
+
+    std::vector<void*> pages(count);
+    std::vector<int>   status(count, -1);
+    for (size_t ip = 0; ip < count; ++ip) {
+        pages[ip] = reinterpret_cast<void*>(first + ip * page);
+    }
+    n_page->assign(NumaNodeCount(), 0);
+    (*n_absent) = 0;
+    // without target nodes, move_pages only returns the node of every page
+    if (count > 0 && syscall(SYS_move_pages, 0, count, pages.data(), nullptr, status.data(), 0) != 0) {
+        return false;
+    }
+    for (size_t ip = 0; ip < count; ++ip) {
+        if (0 <= status[ip] && status[ip] < static_cast<int>(n_page->size())) {
+            (*n_page)[status[ip]] += 1;
+        } else {
+            (*n_absent) += 1;
+        }
+    }
+    return true;
+    //--------------------------------------------------------------------------
+}
+
+//==============================================================================
+// HUGE PAGES
+//==============================================================================
+/**
+ * @brief maps memory backed by huge pages, aligned on h3lpr_huge_size
+ *
+ * MAP_HUGETLB is tried first, it only succeeds if huge pages have been reserved (see /proc/sys/vm/nr_hugepages).
+ * Otherwise a region aligned on h3lpr_huge_size is mapped and madvise(MADV_HUGEPAGE) asks for transparent huge pages.
+ *
+ * @param size_byte the requested size
+ * @param map_byte the size mapped, a multiple of h3lpr_huge_size
+ * @param path the path taken
+ * @return void* the memory
+ */
+void* HugeAlloc(const size_t size_byte, size_t* map_byte, HugePath_t* path) {
+    //--------------------------------------------------------------------------
+    (*map_byte) = m_max((size_byte + h3lpr_huge_size - 1) / h3lpr_huge_size, static_cast<size_t>(1)) * h3lpr_huge_size;
+
+    // try the reserved huge pages
+    void* ptr = mmap(nullptr, (*map_byte), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr != MAP_FAILED) {
+        (*path) = H3LPR_HUGE_HUGETLB;
+        return ptr;
+    }
+
+    // map one more huge page and trim the region to get the alignment
+    const size_t over_byte = (*map_byte) + h3lpr_huge_size;
+    void*        over_ptr  = mmap(nullptr, over_byte, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    m_assert_h3lpr(over_ptr != MAP_FAILED, "unable to map %ld bytes", over_byte);
+    const uintptr_t over_addr = reinterpret_cast<uintptr_t>(over_ptr);
+    const uintptr_t addr      = (over_addr + h3lpr_huge_size - 1) / h3lpr_huge_size * h3lpr_huge_size;
+    const size_t    head      = addr - over_addr;
+    const size_t    tail      = over_byte - head - (*map_byte);
+    if (head > 0) {
+        munmap(over_ptr, head);
+    }
+    if (tail > 0) {
+        munmap(reinterpret_cast<void*>(addr + (*map_byte)), tail);
+    }
+    ptr     = reinterpret_cast<void*>(addr);
+    (*path) = (madvise(ptr, (*map_byte), MADV_HUGEPAGE) == 0) ? H3LPR_HUGE_THP : H3LPR_HUGE_NONE;
+    return ptr;
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief unmaps memory obtained with HugeAlloc
+ */
+void HugeFree(void* ptr, const size_t map_byte) {
+    //--------------------------------------------------------------------------
+    munmap(ptr, map_byte);
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief extends in place a mapping obtained with HugeAlloc using mremap, the new pages are zeroed
+ *
+ * @param ptr the memory
+ * @param map_byte the size mapped, updated if the mapping is extended
+ * @param size_byte the requested size
+ * @param path the path taken by HugeAlloc
+ * @return false if the mapping cannot be extended without being moved
+ */
+bool HugeExtend(void* ptr, size_t* map_byte, const size_t size_byte, const HugePath_t path) {
+    //--------------------------------------------------------------------------
+    const size_t new_map_byte = (size_byte + h3lpr_huge_size - 1) / h3lpr_huge_size * h3lpr_huge_size;
+    if (new_map_byte <= (*map_byte)) {
+        return true;
+    }
+    // don't move the mapping to keep the alignment on the huge pages
+    if (mremap(ptr, (*map_byte), new_map_byte, 0) == MAP_FAILED) {
+        return false;
+    }
+    if (path == H3LPR_HUGE_THP) {
+        madvise(reinterpret_cast<char*>(ptr) + (*map_byte), new_map_byte - (*map_byte), MADV_HUGEPAGE);
+    }
+    (*map_byte) = new_map_byte;
+    return true;
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief returns the number of huge pages backing the mapping that contains ptr, read from /proc/self/smaps
+ */
+size_t HugePageCount(const void* ptr) {
+    //--------------------------------------------------------------------------
+    FILE* file = fopen("/proc/self/smaps", "r");
+    if (file == nullptr) {
+        return 0;
+    }
+    const uintptr_t addr     = reinterpret_cast<uintptr_t>(ptr);
+    bool            is_found = false;
+    size_t          huge_kb  = 0;
+    char            line[512];
+    while (fgets(line, 512, file) != nullptr) {
+        uintptr_t first;
+        uintptr_t last;
+        size_t    value;
+        // a new mapping starts with its address range
+        if (sscanf(line, "%lx-%lx ", &first, &last) == 2) {
+            if (is_found) {
+                break;
+            }
+            is_found = (first <= addr && addr < last);
+        } else if (is_found && (sscanf(line, "AnonHugePages: %lu kB", &value) == 1 ||
+                                sscanf(line, "Private_Hugetlb: %lu kB", &value) == 1 ||
+                                sscanf(line, "Shared_Hugetlb: %lu kB", &value) == 1)) {
+            huge_kb += value;
+        }
+    }
+    fclose(file);
+    return (huge_kb * 1024) / h3lpr_huge_size;
+    //--------------------------------------------------------------------------
+}
+
+//==============================================================================
+// POOL ALLOCATOR
+//==============================================================================
+static constexpr int    pool_min_class  = 6;   //!< the smallest size class: 2^6 = 64 bytes
+static constexpr int    pool_max_class  = 40;  //!< the largest size class: 2^40 bytes
+static constexpr size_t pool_cache_size = 8;   //!< max number of blocks per size class kept in the thread caches
+
+/**
+ * @brief returns the key of a size class and an alignment
+ */
+static inline uint64_t PoolKey(const int iclass, const size_t alignment) {
+    return (static_cast<uint64_t>(alignment) << 8) | static_cast<uint64_t>(iclass);
+}
+
+/**
+ * @brief global counters of the pool, see PoolStats
+ */
+struct PoolCounter {
+    std::atomic<size_t> n_hit          = {0};
+    std::atomic<size_t> n_miss         = {0};
+    std::atomic<size_t> n_free         = {0};
+    std::atomic<size_t> byte_requested = {0};
+    std::atomic<size_t> byte_used      = {0};
+    std::atomic<size_t> byte_cached    = {0};
+};
+
+/**
+ * @brief the global pool, shared by all the threads and protected by a mutex
+ */
+struct PoolGlobal {
+    std::mutex                                        mutex;
+    std::unordered_map<uint64_t, std::vector<void*>> free_list;
+
+    ~PoolGlobal() {
+        for (auto& it : free_list) {
+            for (void* ptr : it.second) {
+                std::free(ptr);
+            }
+        }
+    }
+};
+
+/**
+ * @brief the cache of a thread, given back to the global pool when the thread terminates
+ */
+struct PoolCache {
+    std::unordered_map<uint64_t, std::vector<void*>> free_list;
+
+    ~PoolCache();
+};
+
+static PoolCounter            pool_counter;
+static PoolGlobal             pool_global;
+static thread_local PoolCache pool_cache;
+
+PoolCache::~PoolCache() {
+    std::lock_guard<std::mutex> lock(pool_global.mutex);
+    for (auto& it : free_list) {
+        std::vector<void*>& global_list = pool_global.free_list[it.first];
+        global_list.insert(global_list.end(), it.second.begin(), it.second.end());
+    }
+}
+
+/**
+ * @brief returns the size class of an allocation: the smallest power of 2 bigger than size_byte and alignment
+ */
+int PoolSizeClass(const size_t size_byte, const size_t alignment) {
+    //--------------------------------------------------------------------------
+    const size_t min_byte = m_max(m_max(size_byte, alignment), static_cast<size_t>(1) << pool_min_class);
+    int          iclass   = pool_min_class;
+    while ((static_cast<size_t>(1) << iclass) < min_byte) {
+        ++iclass;
+    }
+    m_assert_h3lpr(iclass <= pool_max_class, "the size %ld is too big for the pool", size_byte);
+    return iclass;
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief returns a block of the size class, from the cache of the thread, from the global pool or from the system
+ *
+ * @param iclass the size class, see PoolSizeClass
+ * @param alignment the alignment of the block
+ * @param size_byte the size requested, used for the statistics
+ */
+void* PoolAlloc(const int iclass, const size_t alignment, const size_t size_byte) {
+    //--------------------------------------------------------------------------
+    const uint64_t key        = PoolKey(iclass, alignment);
+    const size_t   class_byte = static_cast<size_t>(1) << iclass;
+    void*          ptr        = nullptr;
+
+    // try the cache of the thread
+    auto cache_it = pool_cache.free_list.find(key);
+    if (cache_it != pool_cache.free_list.end() && !cache_it->second.empty()) {
+        ptr = cache_it->second.back();
+        cache_it->second.pop_back();
+    }
+    // try the global pool
+    if (ptr == nullptr) {
+        std::lock_guard<std::mutex> lock(pool_global.mutex);
+        auto                        global_it = pool_global.free_list.find(key);
+        if (global_it != pool_global.free_list.end() && !global_it->second.empty()) {
+            ptr = global_it->second.back();
+            global_it->second.pop_back();
+        }
+    }
+    // get it from the system
+    if (ptr != nullptr) {
+        pool_counter.n_hit += 1;
+        pool_counter.byte_cached -= class_byte;
+    } else {
+        pool_counter.n_miss += 1;
+        const int err = posix_memalign(&ptr, m_max(alignment, sizeof(void*)), class_byte);
+        m_assert_h3lpr(err == 0, "unable to allocate %ld bytes", class_byte);
+    }
+    pool_counter.byte_requested += size_byte;
+    pool_counter.byte_used += class_byte;
+    return ptr;
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief gives a block back to the cache of the thread, or to the global pool if the cache is full
+ */
+void PoolFree(void* ptr, const int iclass, const size_t alignment, const size_t size_byte) {
+    //--------------------------------------------------------------------------
+    const uint64_t key        = PoolKey(iclass, alignment);
+    const size_t   class_byte = static_cast<size_t>(1) << iclass;
+
+    pool_counter.n_free += 1;
+    pool_counter.byte_requested -= size_byte;
+    pool_counter.byte_used -= class_byte;
+    pool_counter.byte_cached += class_byte;
+
+    std::vector<void*>& cache_list = pool_cache.free_list[key];
+    if (cache_list.size() < pool_cache_size) {
+        cache_list.push_back(ptr);
+    } else {
+        std::lock_guard<std::mutex> lock(pool_global.mutex);
+        pool_global.free_list[key].push_back(ptr);
+    }
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief updates the statistics when a block in use grows within its size class
+ */
+void PoolResize(const size_t old_byte, const size_t size_byte) {
+    //--------------------------------------------------------------------------
+    pool_counter.byte_requested += size_byte;
+    pool_counter.byte_requested -= old_byte;
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief returns the blocks of the global pool and of the cache of the calling thread to the system
+ */
+void PoolRelease() {
+    //--------------------------------------------------------------------------
+    auto release = [](std::unordered_map<uint64_t, std::vector<void*>>* free_list) {
+        for (auto& it : *free_list) {
+            const size_t class_byte = static_cast<size_t>(1) << (it.first & 0xff);
+            for (void* ptr : it.second) {
+                std::free(ptr);
+                pool_counter.byte_cached -= class_byte;
+            }
+            it.second.clear();
+        }
+    };
+    release(&pool_cache.free_list);
+    std::lock_guard<std::mutex> lock(pool_global.mutex);
+    release(&pool_global.free_list);
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief returns the statistics of the pool (all threads)
+ */
+PoolStats PoolGetStats() {
+    //--------------------------------------------------------------------------
+    PoolStats stats;
+    stats.n_hit          = pool_counter.n_hit;
+    stats.n_miss         = pool_counter.n_miss;
+    stats.n_free         = pool_counter.n_free;
+    stats.byte_requested = pool_counter.byte_requested;
+    stats.byte_used      = pool_counter.byte_used;
+    stats.byte_cached    = pool_counter.byte_cached;
+    return stats;
+    //--------------------------------------------------------------------------
+}
+
+/**
+ * @brief displays the statistics of the pool: hit rate and fragmentation
+ *
+ * The internal fragmentation is the fraction of the memory in use lost because of the rounding to the size classes.
+ * The external fragmentation is the fraction of the memory held by the pool that is cached (not in use).
+ */
+void PoolDisp() {
+    //--------------------------------------------------------------------------
+    const PoolStats stats  = PoolGetStats();
+    const size_t    n_call = stats.n_hit + stats.n_miss;
+    const size_t    n_held = stats.byte_used + stats.byte_cached;
+    m_log_h3lpr("pool: %ld allocations, hit rate = %.1f%%", n_call, (n_call > 0) ? (100.0 * stats.n_hit / n_call) : 0.0);
+    m_log_h3lpr("pool: %.3f MB in use (%.3f MB requested), %.3f MB cached", stats.byte_used / 1048576.0, stats.byte_requested / 1048576.0, stats.byte_cached / 1048576.0);
+    m_log_h3lpr("pool: internal fragmentation = %.1f%%, external fragmentation = %.1f%%",
+                (stats.byte_used > 0) ? (100.0 * (stats.byte_used - stats.byte_requested) / stats.byte_used) : 0.0,
+                (n_held > 0) ? (100.0 * stats.byte_cached / n_held) : 0.0);
+    //--------------------------------------------------------------------------
+}
+
+};  // namespace H3LPR
@@ -7,6 +7,8 @@
 #define H3LPR_SRC_PTR_HPP_
 
 #include <cstdint>
+#include <cstring>
+#include <vector>
 
 #include "macros.hpp"
 #include "mpi.h"
@@ -16,9 +18,78 @@ namespace H3LPR {
 
 typedef enum Allocation_t {
     H3LPR_ALLOC_POSIX,
-    H3LPR_ALLOC_MPI
+    H3LPR_ALLOC_MPI,
+    H3LPR_ALLOC_POOL,
+    H3LPR_ALLOC_HUGE,
+    H3LPR_ALLOC_MPI_SHARED,
+    H3LPR_ALLOC_MPI_WIN
 } Allocation_t;
 
+/**
+ * @brief initialization of the memory at the allocation
+ */
+typedef enum Init_t {
+    H3LPR_INIT_ZERO,       //!< the memory is set to 0 by the calling thread
+    H3LPR_INIT_NONE,       //!< the memory is not initialized
+    H3LPR_INIT_FIRSTTOUCH  //!< the memory is set to 0 by the OpenMP threads, using a static schedule (first touch placement)
+} Init_t;
+
+void InitMemory(void* ptr, const size_t size_byte, const Init_t init);
+
+/**
+ * @brief placement of the memory on the NUMA nodes, applied before the initialization
+ *
+ * The policy is applied without MPOL_MF_MOVE: it only places the pages touched afterwards. The memory that is already
+ * faulted is not moved, which is the case of a POSIX or MPI allocation reusing memory freed by the process.
+ */
+typedef enum Numa_t {
+    H3LPR_NUMA_DEFAULT,     //!< the policy of the process is used (first touch)
+    H3LPR_NUMA_LOCAL,       //!< the memory is placed on the node of the thread that touches it first
+    H3LPR_NUMA_INTERLEAVE,  //!< the pages are interleaved on all the nodes
+    H3LPR_NUMA_BIND,        //!< the memory is placed on a given node
+    H3LPR_NUMA_CHUNKED      //!< the memory is split as a static schedule and each chunk is placed on the node of its OpenMP thread
+} Numa_t;
+
+int  NumaNodeCount();
+bool NumaPlace(void* ptr, const size_t size_byte, const Numa_t numa, const int numa_node = 0);
+bool NumaPages(const void* ptr, const size_t size_byte, std::vector<size_t>* n_page, size_t* n_absent);
+
+/**
+ * @brief the way the memory of H3LPR_ALLOC_HUGE has been obtained
+ */
+typedef enum HugePath_t {
+    H3LPR_HUGE_HUGETLB,  //!< mmap with MAP_HUGETLB: huge pages reserved in hugetlbfs
+    H3LPR_HUGE_THP,      //!< mmap aligned on 2MB with madvise(MADV_HUGEPAGE): transparent huge pages
+    H3LPR_HUGE_NONE      //!< mmap without huge pages
+} HugePath_t;
+
+constexpr size_t h3lpr_huge_size = 2 * 1024 * 1024;  //!< the size of the huge pages
+
+void*  HugeAlloc(const size_t size_byte, size_t* map_byte, HugePath_t* path);
+void   HugeFree(void* ptr, const size_t map_byte);
+bool   HugeExtend(void* ptr, size_t* map_byte, const size_t size_byte, const HugePath_t path);
+size_t HugePageCount(const void* ptr);
+
+/**
+ * @brief statistics of the pool allocator (H3LPR_ALLOC_POOL)
+ */
+struct PoolStats {
+    size_t n_hit;           //!< number of allocations served by the pool
+    size_t n_miss;          //!< number of allocations served by the system
+    size_t n_free;          //!< number of blocks given back to the pool
+    size_t byte_requested;  //!< the memory requested by the blocks in use
+    size_t byte_used;       //!< the memory of the blocks in use (rounded to the size classes)
+    size_t byte_cached;     //!< the memory of the blocks held by the pool, ready to be reused
+};
+
+int       PoolSizeClass(const size_t size_byte, const size_t alignment);
+void*     PoolAlloc(const int iclass, const size_t alignment, const size_t size_byte);
+void      PoolFree(void* ptr, const int iclass, const size_t alignment, const size_t size_byte);
+void      PoolResize(const size_t old_byte, const size_t size_byte);
+void      PoolRelease();
+PoolStats PoolGetStats();
+void      PoolDisp();
+
 template <Allocation_t L, typename T, int ALG>
 class m_ptr;
 
@@ -31,15 +102,26 @@ class m_ptr<H3LPR_ALLOC_POSIX, T, ALG> {
    public:
     m_ptr() : ptr_(nullptr){};
 
-    explicit m_ptr(const size_t size_byte) noexcept { calloc(size_byte); };
+    explicit m_ptr(const size_t size_byte, const Init_t init = H3LPR_INIT_ZERO, const Numa_t numa = H3LPR_NUMA_DEFAULT, const int numa_node = 0) noexcept {
+        calloc(size_byte, init, numa, numa_node);
+    };
 
-    void calloc(const size_t size_byte) {
+    /**
+     * @brief allocates memory aligned on ALG bytes
+     *
+     * @param size_byte the memory size in byte
+     * @param init the initialization of the memory
+     * @param numa the placement of the memory on the NUMA nodes
+     * @param numa_node the node used with H3LPR_NUMA_BIND
+     */
+    void calloc(const size_t size_byte, const Init_t init = H3LPR_INIT_ZERO, const Numa_t numa = H3LPR_NUMA_DEFAULT, const int numa_node = 0) {
         //----------------------------------------------------------------------
         // first get a multiple of the alignment as a size (in case we allocate back to back, unsure why though...)
         size_t size        = (size_t)(size_byte) + (ALG - 1);
         size_t padded_size = (size) - (size % ALG);
         posix_memalign(&ptr_, ALG, padded_size);
-        std::memset(ptr_, 0, padded_size);
+        NumaPlace(ptr_, padded_size, numa, numa_node);
+        InitMemory(ptr_, padded_size, init);
         //----------------------------------------------------------------------
     };
 
@@ -69,14 +151,19 @@ class m_ptr<H3LPR_ALLOC_MPI, T, ALG> {
    public:
     m_ptr() : ptr_(nullptr), offset_byte_(0){};
 
-    explicit m_ptr(const size_t size_byte) noexcept { calloc(size_byte); };
+    explicit m_ptr(const size_t size_byte, const Init_t init = H3LPR_INIT_ZERO, const Numa_t numa = H3LPR_NUMA_DEFAULT, const int numa_node = 0) noexcept {
+        calloc(size_byte, init, numa, numa_node);
+    };
 
     /**
      * @brief allocates memory aligned on ALG bytes
      *
      * @param size_byte the memory size in byte
+     * @param init the initialization of the memory
+     * @param numa the placement of the memory on the NUMA nodes
+     * @param numa_node the node used with H3LPR_NUMA_BIND
      */
-    void calloc(const MPI_Aint size_byte) {
+    void calloc(const MPI_Aint size_byte, const Init_t init = H3LPR_INIT_ZERO, const Numa_t numa = H3LPR_NUMA_DEFAULT, const int numa_node = 0) {
         //----------------------------------------------------------------------
         // first get a multiple of the alignment as a size (in case we allocate back to back, unsure why though...)
         size_t size        = (size_t)(size_byte) + (ALG - 1);
@@ -84,7 +171,8 @@ class m_ptr<H3LPR_ALLOC_MPI, T, ALG> {
         // add 1 x the alginment in case the allocation is not aligned
         MPI_Aint alloc_size = (MPI_Aint)(padded_size + ALG);
         MPI_Alloc_mem(alloc_size, MPI_INFO_NULL, &ptr_);
-        std::memset(ptr_, 0, alloc_size);
+        NumaPlace(ptr_, alloc_size, numa, numa_node);
+        InitMemory(ptr_, alloc_size, init);
 
         // get the offset in byte, i.e. the address at which the memory is aligned
         const size_t ptr_mod = ((uintptr_t)(ptr_) % ALG);
@@ -111,6 +199,556 @@ class m_ptr<H3LPR_ALLOC_MPI, T, ALG> {
         //----------------------------------------------------------------------
     };
 };
+
+//==============================================================================
+/**
+ * @brief allocates memory in a MPI shared window on the node (NodeComm()), the segments of the other ranks of the node can be accessed directly
+ *
+ * The allocation and the free are collective on NodeComm(), every rank of the node gets its own segment (possibly of a different size).
+ * A passive epoch (MPI_Win_lock_all) is opened for the lifetime of the window, use sync() between the writes and the reads of other ranks.
+ *
+ * @warning the segments are mapped at page boundaries, the aligned views of the other ranks are then consistent as long as ALG divides the page size
+ */
+template <typename T, int ALG>
+class m_ptr<H3LPR_ALLOC_MPI_SHARED, T, ALG> {
+    void*   ptr_;
+    size_t  offset_byte_;
+    MPI_Win win_;
+
+   public:
+    m_ptr() : ptr_(nullptr), offset_byte_(0), win_(MPI_WIN_NULL){};
+
+    explicit m_ptr(const size_t size_byte, const Init_t init = H3LPR_INIT_ZERO, const Numa_t numa = H3LPR_NUMA_DEFAULT, const int numa_node = 0) noexcept {
+        calloc(size_byte, init, numa, numa_node);
+    };
+
+    /**
+     * @brief allocates memory aligned on ALG bytes in the shared window
+     *
+     * @warning collective on NodeComm()
+     *
+     * @param size_byte the memory size in byte
+     * @param init the initialization of the memory
+     * @param numa the placement of the memory on the NUMA nodes
+     * @param numa_node the node used with H3LPR_NUMA_BIND
+     */
+    void calloc(const MPI_Aint size_byte, const Init_t init = H3LPR_INIT_ZERO, const Numa_t numa = H3LPR_NUMA_DEFAULT, const int numa_node = 0) {
+        //----------------------------------------------------------------------
+        // get a multiple of the alignment + 1 x the alignment in case the allocation is not aligned
+        size_t   size        = (size_t)(size_byte) + (ALG - 1);
+        size_t   padded_size = (size) - (size % ALG);
+        MPI_Aint alloc_size  = (MPI_Aint)(padded_size + ALG);
+
+        // the segments don't need to be contiguous, each one can then be placed on the NUMA node of its rank
+        MPI_Info info;
+        MPI_Info_create(&info);
+        MPI_Info_set(info, "alloc_shared_noncontig", "true");
+        MPI_Win_allocate_shared(alloc_size, 1, info, NodeComm(), &ptr_, &win_);
+        MPI_Info_free(&info);
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, win_);
+
+        NumaPlace(ptr_, alloc_size, numa, numa_node);
+        InitMemory(ptr_, alloc_size, init);
+        offset_byte_ = Offset_(ptr_);
+
+        // the other ranks see the initialized memory
+        sync();
+        //----------------------------------------------------------------------
+    };
+
+    /**
+     * @brief frees the window
+     *
+     * @warning collective on NodeComm()
+     */
+    void free() {
+        //----------------------------------------------------------------------
+        if (win_ != MPI_WIN_NULL) {
+            MPI_Win_unlock_all(win_);
+            MPI_Win_free(&win_);
+            ptr_ = nullptr;
+        }
+        //----------------------------------------------------------------------
+    };
+
+    /**
+     * @brief makes the writes to the window visible to the other ranks of the node and waits for them
+     *
+     * @warning collective on NodeComm()
+     */
+    void sync() const {
+        //----------------------------------------------------------------------
+        MPI_Win_sync(win_);
+        MPI_Barrier(NodeComm());
+        MPI_Win_sync(win_);
+        //----------------------------------------------------------------------
+    };
+
+    /**
+     * @brief returns the aligned view on the segment of another rank of the node, obtained with MPI_Win_shared_query
+     *
+     * @param node_rank the rank in NodeComm()
+     * @param size_byte if not nullptr, the usable size of the segment in byte
+     */
+    T shared(const int node_rank, size_t* size_byte = nullptr) const {
+        //----------------------------------------------------------------------
+        m_assert_h3lpr(win_ != MPI_WIN_NULL, "The window shouldn't be null here");
+        MPI_Aint seg_size;
+        int      disp_unit;
+        void*    seg_ptr;
+        MPI_Win_shared_query(win_, node_rank, &seg_size, &disp_unit, &seg_ptr);
+        const size_t seg_offset = Offset_(seg_ptr);
+        if (size_byte != nullptr) {
+            (*size_byte) = (seg_size > (MPI_Aint)(ALG)) ? ((size_t)(seg_size)-ALG) : 0;
+        }
+        return reinterpret_cast<T>((uintptr_t)(seg_ptr) + seg_offset);
+        //----------------------------------------------------------------------
+    };
+
+    MPI_Win win() const noexcept { return win_; }
+
+    T operator()() const noexcept {
+        //----------------------------------------------------------------------
+        m_assert_h3lpr(ptr_ != nullptr, "The pointer shouldn't be nullptr here");
+        m_assert_h3lpr(offset_byte_ < ALG, "the modulo = %ld cannot be bigger than %d", offset_byte_, ALG);
+        return reinterpret_cast<T>((uintptr_t)(ptr_) + offset_byte_);
+        //----------------------------------------------------------------------
+    };
+
+   private:
+    /** @brief returns the offset in byte at which the memory is aligned */
+    static size_t Offset_(const void* ptr) noexcept {
+        const size_t ptr_mod = ((uintptr_t)(ptr) % ALG);
+        return (ptr_mod == 0) ? 0 : (ALG - ptr_mod);
+    }
+};
+
+//==============================================================================
+/**
+ * @brief allocates memory with MPI_Win_allocate and keeps the window for its lifetime, to be used for the one-sided communications
+ *
+ * The window is created once, the MPI library can then register the memory once instead of every time a window is created.
+ * The displacement unit is 1 byte, use disp() to get the displacement of the aligned view of another rank.
+ * The allocation and the free are collective on MPI_COMM_WORLD.
+ */
+template <typename T, int ALG>
+class m_ptr<H3LPR_ALLOC_MPI_WIN, T, ALG> {
+    void*                 ptr_;
+    size_t                offset_byte_;
+    MPI_Win               win_;
+    std::vector<MPI_Aint> disp_;  //!< the offset of the aligned view of every rank
+
+   public:
+    m_ptr() : ptr_(nullptr), offset_byte_(0), win_(MPI_WIN_NULL){};
+
+    explicit m_ptr(const size_t size_byte, const Init_t init = H3LPR_INIT_ZERO, const Numa_t numa = H3LPR_NUMA_DEFAULT, const int numa_node = 0) noexcept {
+        calloc(size_byte, init, numa, numa_node);
+    };
+
+    /**
+     * @brief allocates memory aligned on ALG bytes and creates the window
+     *
+     * @warning collective on MPI_COMM_WORLD
+     *
+     * @param size_byte the memory size in byte
+     * @param init the initialization of the memory
+     * @param numa the placement of the memory on the NUMA nodes
+     * @param numa_node the node used with H3LPR_NUMA_BIND
+     */
+    void calloc(const MPI_Aint size_byte, const Init_t init = H3LPR_INIT_ZERO, const Numa_t numa = H3LPR_NUMA_DEFAULT, const int numa_node = 0) {
+        //----------------------------------------------------------------------
+        // get a multiple of the alignment + 1 x the alignment in case the allocation is not aligned
+        size_t   size        = (size_t)(size_byte) + (ALG - 1);
+        size_t   padded_size = (size) - (size % ALG);
+        MPI_Aint alloc_size  = (MPI_Aint)(padded_size + ALG);
+        MPI_Win_allocate(alloc_size, 1, MPI_INFO_NULL, MPI_COMM_WORLD, &ptr_, &win_);
+        NumaPlace(ptr_, alloc_size, numa, numa_node);
+        InitMemory(ptr_, alloc_size, init);
+
+        // get the offset in byte, i.e. the address at which the memory is aligned
+        const size_t ptr_mod = ((uintptr_t)(ptr_) % ALG);
+        offset_byte_         = (ptr_mod == 0) ? 0 : (ALG - ptr_mod);
+        m_assert_h3lpr(offset_byte_ < ALG, "the modulo = %ld cannot be bigger than %d", offset_byte_, ALG);
+
+        // the offsets of the other ranks, needed to compute the displacements
+        int comm_size;
+        MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+        disp_.resize(comm_size);
+        const MPI_Aint offset = (MPI_Aint)(offset_byte_);
+        MPI_Allgather(&offset, 1, MPI_AINT, disp_.data(), 1, MPI_AINT, MPI_COMM_WORLD);
+        //----------------------------------------------------------------------
+    };
+
+    /**
+     * @brief frees the window and the memory
+     *
+     * @warning collective on MPI_COMM_WORLD
+     */
+    void free() {
+        //----------------------------------------------------------------------
+        if (win_ != MPI_WIN_NULL) {
+            MPI_Win_free(&win_);
+            ptr_ = nullptr;
+            disp_.clear();
+        }
+        //----------------------------------------------------------------------
+    };
+
+    MPI_Win win() const noexcept { return win_; }
+
+    /**
+     * @brief returns the displacement in the window of a given byte of the aligned view of a rank
+     *
+     * @param rank the rank in MPI_COMM_WORLD
+     * @param index_byte the position of the byte in the aligned view of the rank
+     */
+    MPI_Aint disp(const int rank, const size_t index_byte = 0) const {
+        //----------------------------------------------------------------------
+        m_assert_h3lpr(0 <= rank && rank < (int)(disp_.size()), "the rank %d is not in the window", rank);
+        return disp_[rank] + (MPI_Aint)(index_byte);
+        //----------------------------------------------------------------------
+    };
+
+    T operator()() const noexcept {
+        //----------------------------------------------------------------------
+        m_assert_h3lpr(ptr_ != nullptr, "The pointer shouldn't be nullptr here");
+        m_assert_h3lpr(offset_byte_ < ALG, "the modulo = %ld cannot be bigger than %d", offset_byte_, ALG);
+        return reinterpret_cast<T>((uintptr_t)(ptr_) + offset_byte_);
+        //----------------------------------------------------------------------
+    };
+};
+
+//==============================================================================
+// POOL ALLOCATOR
+/**
+ * @brief allocates from a pool of blocks sorted by size classes (powers of 2) and alignment
+ *
+ * A freed block is kept in the cache of the thread (or in the global pool when the cache is full)
+ * and reused by the next allocation of the same size class, without going back to the system.
+ * Only the requested size is initialized, the initialization and the NUMA policy have no effect on the placement of a reused block.
+ * See PoolDisp() for the statistics and PoolRelease() to return the memory to the system.
+ */
+template <typename T, int ALG>
+class m_ptr<H3LPR_ALLOC_POOL, T, ALG> {
+    void*  ptr_;
+    int    iclass_;
+    size_t size_byte_;
+
+   public:
+    m_ptr() : ptr_(nullptr), iclass_(0), size_byte_(0){};
+
+    explicit m_ptr(const size_t size_byte, const Init_t init = H3LPR_INIT_ZERO, const Numa_t numa = H3LPR_NUMA_DEFAULT, const int numa_node = 0) noexcept {
+        calloc(size_byte, init, numa, numa_node);
+    };
+
+    /**
+     * @brief allocates memory aligned on ALG bytes
+     *
+     * @param size_byte the memory size in byte
+     * @param init the initialization of the memory
+     * @param numa the placement of the memory on the NUMA nodes
+     * @param numa_node the node used with H3LPR_NUMA_BIND
+     */
+    void calloc(const size_t size_byte, const Init_t init = H3LPR_INIT_ZERO, const Numa_t numa = H3LPR_NUMA_DEFAULT, const int numa_node = 0) {
+        //----------------------------------------------------------------------
+        size_byte_ = size_byte;
+        iclass_    = PoolSizeClass(size_byte, ALG);
+        ptr_       = PoolAlloc(iclass_, ALG, size_byte);
+        NumaPlace(ptr_, size_byte, numa, numa_node);
+        InitMemory(ptr_, size_byte, init);
+        //----------------------------------------------------------------------
+    };
+
+    void free() {
+        //----------------------------------------------------------------------
+        if (ptr_ != nullptr) {
+            PoolFree(ptr_, iclass_, ALG, size_byte_);
+            ptr_ = nullptr;
+        }
+        //----------------------------------------------------------------------
+    };
+
+    /**
+     * @brief extends the memory in place to size_byte if it fits in the size class, the new bytes are not initialized
+     *
+     * @return false if the size class is too small, the memory is then unchanged
+     */
+    bool extend(const size_t size_byte) {
+        //----------------------------------------------------------------------
+        m_assert_h3lpr(ptr_ != nullptr, "The pointer shouldn't be nullptr here");
+        if (size_byte > capacity()) {
+            return false;
+        }
+        if (size_byte > size_byte_) {
+            PoolResize(size_byte_, size_byte);
+            size_byte_ = size_byte;
+        }
+        return true;
+        //----------------------------------------------------------------------
+    };
+
+    /** @brief returns the number of bytes that can be used without extending the memory: the size of the class */
+    size_t capacity() const noexcept { return static_cast<size_t>(1) << iclass_; }
+
+    T operator()() const noexcept {
+        //----------------------------------------------------------------------
+        m_assert_h3lpr(ptr_ != nullptr, "The pointer shouldn't be nullptr here");
+        return reinterpret_cast<T>(ptr_);
+        //----------------------------------------------------------------------
+    };
+};
+
+//==============================================================================
+// HUGE PAGES ALLOCATOR
+/**
+ * @brief allocates memory backed by huge pages (2MB), to reduce the TLB misses on large arrays
+ *
+ * The memory comes from hugetlbfs (MAP_HUGETLB) if huge pages are available,
+ * from transparent huge pages (madvise(MADV_HUGEPAGE) on a 2MB-aligned region) otherwise.
+ * See path() for the path taken and huge_page_count() for the number of huge pages obtained.
+ * The memory given by mmap is already zeroed, H3LPR_INIT_ZERO doesn't touch it.
+ */
+template <typename T, int ALG>
+class m_ptr<H3LPR_ALLOC_HUGE, T, ALG> {
+    static_assert(ALG <= h3lpr_huge_size, "the alignment cannot be bigger than a huge page");
+    void*      ptr_;
+    size_t     map_byte_;
+    HugePath_t path_;
+
+   public:
+    m_ptr() : ptr_(nullptr), map_byte_(0), path_(H3LPR_HUGE_NONE){};
+
+    explicit m_ptr(const size_t size_byte, const Init_t init = H3LPR_INIT_ZERO, const Numa_t numa = H3LPR_NUMA_DEFAULT, const int numa_node = 0) noexcept {
+        calloc(size_byte, init, numa, numa_node);
+    };
+
+    /**
+     * @brief allocates memory aligned on 2MB
+     *
+     * @param size_byte the memory size in byte
+     * @param init the initialization of the memory
+     * @param numa the placement of the memory on the NUMA nodes
+     * @param numa_node the node used with H3LPR_NUMA_BIND
+     */
+    void calloc(const size_t size_byte, const Init_t init = H3LPR_INIT_ZERO, const Numa_t numa = H3LPR_NUMA_DEFAULT, const int numa_node = 0) {
+        //----------------------------------------------------------------------
+        ptr_ = HugeAlloc(size_byte, &map_byte_, &path_);
+        NumaPlace(ptr_, map_byte_, numa, numa_node);
+        // the memory is already zeroed, only the first touch is needed
+        if (init == H3LPR_INIT_FIRSTTOUCH) {
+            InitMemory(ptr_, map_byte_, init);
+        }
+        //----------------------------------------------------------------------
+    };
+
+    void free() {
+        //----------------------------------------------------------------------
+        if (ptr_ != nullptr) {
+            HugeFree(ptr_, map_byte_);
+            ptr_ = nullptr;
+        }
+        //----------------------------------------------------------------------
+    };
+
+    /**
+     * @brief extends the memory in place to (at least) size_byte, the new bytes are zeroed
+     *
+     * @return false if the mapping cannot be extended without being moved, the memory is then unchanged
+     */
+    bool extend(const size_t size_byte) {
+        //----------------------------------------------------------------------
+        m_assert_h3lpr(ptr_ != nullptr, "The pointer shouldn't be nullptr here");
+        return HugeExtend(ptr_, &map_byte_, size_byte, path_);
+        //----------------------------------------------------------------------
+    };
+
+    /** @brief returns the number of bytes that can be used without extending the memory */
+    size_t capacity() const noexcept { return map_byte_; }
+
+    /** @brief returns the path taken to obtain the memory */
+    HugePath_t path() const noexcept { return path_; }
+
+    /** @brief returns the number of huge pages backing the memory (only the touched pages are counted with THP) */
+    size_t huge_page_count() const { return (ptr_ != nullptr) ? HugePageCount(ptr_) : 0; }
+
+    T operator()() const noexcept {
+        //----------------------------------------------------------------------
+        m_assert_h3lpr(ptr_ != nullptr, "The pointer shouldn't be nullptr here");
+        return reinterpret_cast<T>(ptr_);
+        //----------------------------------------------------------------------
+    };
+};
+
+//==============================================================================
+// OWNING POINTER
+/**
+ * @brief owns a m_ptr of a given size: the memory is freed by the destructor, the pointer can be moved but not copied
+ *
+ * The memory can be resized, the alignment is kept and the bytes already there are never initialized again.
+ * For H3LPR_ALLOC_POOL the memory grows in place up to the size of its class.
+ * For H3LPR_ALLOC_HUGE the mapping is extended in place with mremap when possible,
+ * otherwise a new m_ptr is allocated without initialization and the data is copied with memcpy.
+ * The bytes above the high-water mark are still zero from mmap and are not zeroed again when the memory grows.
+ *
+ * The MPI window modes are not supported as their free is collective and cannot be done by a destructor.
+ */
+template <Allocation_t A, typename T, int ALG>
+class m_uptr {
+    static_assert(A != H3LPR_ALLOC_MPI_SHARED && A != H3LPR_ALLOC_MPI_WIN, "the MPI windows cannot be owned by m_uptr");
+    m_ptr<A, T, ALG> ptr_;
+    bool             is_alloc_  = false;  //!< true if ptr_ holds memory
+    size_t           size_byte_ = 0;      //!< the size of the memory in byte
+    size_t           capa_byte_ = 0;      //!< the size that can be used without allocating new memory
+    size_t           mark_byte_ = 0;      //!< the high-water mark: the bytes above it have never been written and are zero
+    Init_t           init_      = H3LPR_INIT_ZERO;
+    Numa_t           numa_      = H3LPR_NUMA_DEFAULT;
+    int              numa_node_ = 0;
+
+   public:
+    m_uptr() = default;
+
+    explicit m_uptr(const size_t size_byte, const Init_t init = H3LPR_INIT_ZERO, const Numa_t numa = H3LPR_NUMA_DEFAULT, const int numa_node = 0)
+        : ptr_(size_byte, init, numa, numa_node), is_alloc_(true), size_byte_(size_byte), capa_byte_(Capacity_(size_byte)), mark_byte_(Mark_(size_byte)), init_(init), numa_(numa), numa_node_(numa_node){};
+
+    ~m_uptr() { free(); }
+
+    m_uptr(const m_uptr&)            = delete;
+    m_uptr& operator=(const m_uptr&) = delete;
+
+    m_uptr(m_uptr&& other) noexcept { Steal_(&other); }
+
+    m_uptr& operator=(m_uptr&& other) noexcept {
+        //----------------------------------------------------------------------
+        if (this != &other) {
+            free();
+            Steal_(&other);
+        }
+        return *this;
+        //----------------------------------------------------------------------
+    }
+
+    void free() {
+        //----------------------------------------------------------------------
+        if (is_alloc_) {
+            ptr_.free();
+            ptr_       = m_ptr<A, T, ALG>();
+            is_alloc_  = false;
+            size_byte_ = 0;
+            capa_byte_ = 0;
+            mark_byte_ = 0;
+        }
+        //----------------------------------------------------------------------
+    };
+
+    /**
+     * @brief changes the size of the memory, the data is kept up to the smallest size and the new bytes are initialized as at the allocation
+     *
+     * @param size_byte the new size in byte
+     */
+    void resize(const size_t size_byte) {
+        //----------------------------------------------------------------------
+        if (!is_alloc_) {
+            ptr_       = m_ptr<A, T, ALG>(size_byte, init_, numa_, numa_node_);
+            is_alloc_  = true;
+            capa_byte_ = Capacity_(size_byte);
+            mark_byte_ = Mark_(size_byte);
+        } else if (size_byte > size_byte_) {
+            if (!Extend_(size_byte)) {
+                // get new memory, only the tail needs to be initialized (new huge pages are already zeroed)
+                const bool       is_zero = (A == H3LPR_ALLOC_HUGE) && (init_ == H3LPR_INIT_ZERO);
+                m_ptr<A, T, ALG> new_ptr(size_byte, H3LPR_INIT_NONE, numa_, numa_node_);
+                std::memcpy(reinterpret_cast<void*>(new_ptr()), reinterpret_cast<void*>(ptr_()), size_byte_);
+                if (!is_zero) {
+                    InitMemory(reinterpret_cast<char*>(new_ptr()) + size_byte_, size_byte - size_byte_, init_);
+                }
+                ptr_.free();
+                ptr_       = new_ptr;
+                capa_byte_ = Capacity_(size_byte);
+                mark_byte_ = (is_zero) ? size_byte_ : Mark_(size_byte);
+            }
+        }
+        size_byte_ = size_byte;
+        //----------------------------------------------------------------------
+    };
+
+    size_t size() const noexcept { return size_byte_; }
+    bool   is_alloc() const noexcept { return is_alloc_; }
+
+    T operator()() const noexcept {
+        //----------------------------------------------------------------------
+        m_assert_h3lpr(is_alloc_, "The pointer shouldn't be empty here");
+        return ptr_();
+        //----------------------------------------------------------------------
+    };
+
+   private:
+    void Steal_(m_uptr* other) noexcept {
+        //----------------------------------------------------------------------
+        ptr_              = other->ptr_;
+        is_alloc_         = other->is_alloc_;
+        size_byte_        = other->size_byte_;
+        init_             = other->init_;
+        numa_             = other->numa_;
+        numa_node_        = other->numa_node_;
+        capa_byte_        = other->capa_byte_;
+        mark_byte_        = other->mark_byte_;
+        other->ptr_       = m_ptr<A, T, ALG>();
+        other->is_alloc_  = false;
+        other->size_byte_ = 0;
+        other->capa_byte_ = 0;
+        other->mark_byte_ = 0;
+        //----------------------------------------------------------------------
+    };
+
+    /**
+     * @brief returns the size that can be used once size_byte have been allocated
+     */
+    size_t Capacity_(const size_t size_byte) const noexcept {
+        //----------------------------------------------------------------------
+        if constexpr (A == H3LPR_ALLOC_HUGE || A == H3LPR_ALLOC_POOL) {
+            return ptr_.capacity();
+        } else {
+            return size_byte;
+        }
+        //----------------------------------------------------------------------
+    };
+
+    /**
+     * @brief returns the high-water mark once size_byte have been allocated, a reused pool block may be written up to its capacity
+     */
+    size_t Mark_(const size_t size_byte) const noexcept {
+        //----------------------------------------------------------------------
+        if constexpr (A == H3LPR_ALLOC_POOL) {
+            return ptr_.capacity();
+        } else {
+            return size_byte;
+        }
+        //----------------------------------------------------------------------
+    };
+
+    /**
+     * @brief grows the memory in place if possible, the bytes in [size_byte_, size_byte[ are then initialized
+     */
+    bool Extend_(const size_t size_byte) {
+        //----------------------------------------------------------------------
+        bool is_extended = (size_byte <= capa_byte_);
+        if constexpr (A == H3LPR_ALLOC_HUGE || A == H3LPR_ALLOC_POOL) {
+            is_extended = ptr_.extend(size_byte);
+            capa_byte_  = ptr_.capacity();
+        }
+        if (is_extended) {
+            // the bytes below the mark may have been used before a shrink, the ones above are zero and only need the first touch
+            const size_t init_byte = (init_ == H3LPR_INIT_FIRSTTOUCH) ? size_byte : m_min(size_byte, mark_byte_);
+            if (init_byte > size_byte_) {
+                InitMemory(reinterpret_cast<char*>(ptr_()) + size_byte_, init_byte - size_byte_, init_);
+            }
+            mark_byte_ = m_max(mark_byte_, size_byte);
+        }
+        return is_extended;
+        //----------------------------------------------------------------------
+    };
+};
+
 };  // namespace H3LPR
 
 #endif  // H3LPR_SRC_PTR_HPP_
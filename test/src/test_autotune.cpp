@@ -0,0 +1,122 @@
+#include "autotune.hpp"
+#include "gtest/gtest.h"
+
+using namespace H3LPR;
+using std::string;
+
+class TestAutotune : public ::testing::Test {
+    void SetUp() override {
+        const testing::TestInfo* const test_info = testing::UnitTest::GetInstance()->current_test_info();
+        m_log_noheader("::group:: Testing %s/%s", test_info->test_suite_name(), test_info->name());
+    };
+    void TearDown() override {
+        m_log_noheader("::endgroup::");
+    };
+};
+
+/**
+ * @brief returns a synthetic cost that is minimal for a = 3 and b = 2, independent of the load of the machine
+ */
+static double Cost(const int a, const double b) {
+    return 2e-3 * (1.0 + std::abs(a - 3) + std::abs(b - 2.0));
+}
+
+TEST_F(TestAutotune, descent) {
+    const int   argc   = 2;
+    const char* msg[2] = {"./h3lpr", "--param-b=4"};
+    Parser      parser(argc, msg);
+    Profiler    prof("autotune");
+
+    Autotuner tuner(&parser, &prof, "work", 3);
+    int       a = tuner.Tunable<int>("--param-a", "a tunable int", {1, 3, 5});
+    double    b = tuner.TunableRange<double>("--param-b", "a tunable double", 0.0, 3.0, 1.0);
+    // the initial value of b is the one given by the user, added to the candidates
+    EXPECT_EQ(a, 1);
+    EXPECT_EQ(b, 4.0);
+
+    // the cost is measured for the current values of a and b
+    tuner.SetCost([&a, &b]() { return Cost(a, b); });
+
+    int n_step = 0;
+    while (!tuner.is_done() && n_step < 200) {
+        if (tuner.Step()) {
+            a = tuner.GetValue<int>("--param-a");
+            b = tuner.GetValue<double>("--param-b");
+        }
+        ++n_step;
+    }
+    EXPECT_TRUE(tuner.is_done());
+    EXPECT_EQ(a, 3);
+    EXPECT_EQ(b, 2.0);
+    m_log_h3lpr("autotune done in %d steps, best cost = %e", n_step, tuner.best_cost());
+
+    // the saved configuration can be read by the parser
+    tuner.Save("prof/autotune.config");
+    MPI_Barrier(MPI_COMM_WORLD);
+    const char* msg_config[2] = {"./h3lpr", "--config=prof/autotune.config"};
+    Parser      parser_config(argc, msg_config);
+    EXPECT_EQ(parser_config.GetValue<int>("--param-a", "a tunable int"), 3);
+    EXPECT_EQ(parser_config.GetValue<double>("--param-b", "a tunable double"), 2.0);
+
+    parser.Finalize();
+    parser_config.Finalize();
+}
+
+TEST_F(TestAutotune, range) {
+    const int   argc   = 1;
+    const char* msg[1] = {"./h3lpr"};
+    Parser      parser(argc, msg);
+    Profiler    prof("autotune");
+
+    // 0.1 cannot be represented exactly, the last candidate must still be 0.3
+    Autotuner tuner(&parser, &prof, "work");
+    tuner.TunableRange<double>("--param-c", "a tunable double", 0.0, 0.3, 0.1);
+    int n_candidate = 0;
+    tuner.SetCost([&tuner, &n_candidate]() {
+        n_candidate += 1;
+        return std::abs(tuner.GetValue<double>("--param-c") - 0.3);
+    });
+    while (!tuner.is_done()) {
+        tuner.Step();
+    }
+    EXPECT_EQ(n_candidate, 4);
+    EXPECT_DOUBLE_EQ(tuner.GetValue<double>("--param-c"), 0.3);
+
+    parser.Finalize();
+}
+
+TEST_F(TestAutotune, profiler) {
+    const int   argc   = 1;
+    const char* msg[1] = {"./h3lpr"};
+    Parser      parser(argc, msg);
+    Profiler    prof("autotune");
+
+    // the objective is the time spent in the block, only the decisions are checked, not the value that wins
+    Autotuner tuner(&parser, &prof, "work", 2);
+    int       a = tuner.Tunable<int>("--param-a", "a tunable int", {1, 2, 3});
+
+    int n_step = 0;
+    while (!tuner.is_done() && n_step < 100) {
+        m_profStart(&prof, "work");
+        const double t0 = MPI_Wtime();
+        while (MPI_Wtime() - t0 < 1e-4 * a) {
+        }
+        m_profStop(&prof, "work");
+        if (tuner.Step()) {
+            a = tuner.GetValue<int>("--param-a");
+        }
+        ++n_step;
+    }
+    EXPECT_TRUE(tuner.is_done());
+    EXPECT_GT(tuner.best_cost(), 0.0);
+
+    // the costs are reduced with MPI_MAX, every rank takes the same decisions
+    int a_minmax[2] = {-a, a};
+    MPI_Allreduce(MPI_IN_PLACE, a_minmax, 2, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    EXPECT_EQ(-a_minmax[0], a_minmax[1]);
+    int n_step_max = n_step;
+    MPI_Allreduce(MPI_IN_PLACE, &n_step_max, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    EXPECT_EQ(n_step, n_step_max);
+
+    parser.Finalize();
+}
@@ -1,3 +1,6 @@
+#include <sys/mman.h>
+#include <unistd.h>
+
 #include "gtest/gtest.h"
 #include "macros.hpp"
 #include "ptr.hpp"
@@ -66,4 +69,289 @@ TEST_F(TestMacros, log) {
 
 TEST_F(TestMacros, verb) {
     m_verb_h3lpr("this message should be seen if compiled in VERBOSE");
-}
\ No newline at end of file
+}
+
+TEST_F(TestMacros, pool) {
+    const PoolStats stats_0 = PoolGetStats();
+    // the same sizes are allocated and freed several times
+    for (int it = 0; it < 10; ++it) {
+        m_ptr<H3LPR_ALLOC_POOL, double*, ALIGNMENT> a_ptr(17 * sizeof(double));
+        m_ptr<H3LPR_ALLOC_POOL, double*, 64>        b_ptr(1000 * sizeof(double));
+        double*                                     a = a_ptr();
+        double*                                     b = b_ptr();
+        EXPECT_TRUE(m_isaligned(a, ALIGNMENT));
+        EXPECT_TRUE(m_isaligned(b, 64));
+        // the requested memory is zeroed
+        for (int i = 0; i < 17; ++i) {
+            EXPECT_EQ(a[i], 0.0);
+            a[i] = i;
+        }
+        for (int i = 0; i < 1000; ++i) {
+            EXPECT_EQ(b[i], 0.0);
+            b[i] = i;
+        }
+        a_ptr.free();
+        b_ptr.free();
+    }
+    // only the first allocations go to the system
+    const PoolStats stats_1 = PoolGetStats();
+    EXPECT_EQ(stats_1.n_miss - stats_0.n_miss, 2);
+    EXPECT_EQ(stats_1.n_hit - stats_0.n_hit, 18);
+    EXPECT_EQ(stats_1.byte_used, stats_0.byte_used);
+    PoolDisp();
+
+    // the cached memory goes back to the system
+    PoolRelease();
+    EXPECT_EQ(PoolGetStats().byte_cached, 0);
+}
+
+TEST_F(TestMacros, init) {
+    const size_t n = 1 << 20;
+    {
+        // no initialization, only the alignment is checked
+        m_ptr<H3LPR_ALLOC_POSIX, double*, ALIGNMENT> a_ptr(n * sizeof(double), H3LPR_INIT_NONE);
+        EXPECT_TRUE(m_isaligned(a_ptr(), ALIGNMENT));
+        a_ptr.free();
+    }
+    {
+        // the memory is zeroed by the threads
+        m_ptr<H3LPR_ALLOC_POSIX, double*, ALIGNMENT> a_ptr(n * sizeof(double), H3LPR_INIT_FIRSTTOUCH);
+        m_ptr<H3LPR_ALLOC_MPI, double*, ALIGNMENT>   b_ptr(n * sizeof(double) + 3, H3LPR_INIT_FIRSTTOUCH);
+        double*                                      a = a_ptr();
+        double*                                      b = b_ptr();
+        size_t                                       n_nonzero = 0;
+#pragma omp parallel for schedule(static) reduction(+ : n_nonzero)
+        for (size_t i = 0; i < n; ++i) {
+            n_nonzero += (a[i] != 0.0) + (b[i] != 0.0);
+        }
+        EXPECT_EQ(n_nonzero, 0);
+        a_ptr.free();
+        b_ptr.free();
+    }
+}
+
+TEST_F(TestMacros, numa) {
+    const size_t n      = 1 << 20;
+    const int    n_node = NumaNodeCount();
+    m_log_h3lpr("found %d NUMA node(s)", n_node);
+    ASSERT_GE(n_node, 1);
+
+    const Numa_t policy[5] = {H3LPR_NUMA_DEFAULT, H3LPR_NUMA_LOCAL, H3LPR_NUMA_INTERLEAVE, H3LPR_NUMA_BIND, H3LPR_NUMA_CHUNKED};
+    for (int ip = 0; ip < 5; ++ip) {
+        // the last node is used for the bind, i.e. the only one on single-node machines
+        m_ptr<H3LPR_ALLOC_POSIX, double*, 4096> a_ptr(n * sizeof(double), H3LPR_INIT_FIRSTTOUCH, policy[ip], n_node - 1);
+        double*                                 a = a_ptr();
+        for (size_t i = 0; i < n; i += 512) {
+            EXPECT_EQ(a[i], 0.0);
+        }
+
+        // every page is touched, so every page must be placed
+        std::vector<size_t> n_page;
+        size_t              n_absent;
+        if (NumaPages(a, n * sizeof(double), &n_page, &n_absent)) {
+            size_t n_placed = 0;
+            for (int in = 0; in < n_node; ++in) {
+                n_placed += n_page[in];
+            }
+            EXPECT_EQ(n_absent, 0);
+            EXPECT_EQ(n_placed * sysconf(_SC_PAGESIZE), n * sizeof(double));
+            if (policy[ip] == H3LPR_NUMA_BIND) {
+                EXPECT_EQ(n_page[n_node - 1], n_placed);
+            }
+        } else {
+            m_log_h3lpr("the NUMA query is not supported");
+        }
+        a_ptr.free();
+    }
+}
+
+TEST_F(TestMacros, huge) {
+    const size_t n = 3 * (1 << 20) + 17;
+    const char*  path_name[3] = {"hugetlb", "transparent huge pages", "none"};
+    const Init_t init[2]      = {H3LPR_INIT_ZERO, H3LPR_INIT_FIRSTTOUCH};
+    for (int ii = 0; ii < 2; ++ii) {
+        m_ptr<H3LPR_ALLOC_HUGE, double*, ALIGNMENT> a_ptr(n * sizeof(double), init[ii]);
+        double*                                     a = a_ptr();
+        EXPECT_TRUE(m_isaligned(a, h3lpr_huge_size));
+        // the memory is zeroed and can be used
+        size_t n_nonzero = 0;
+        for (size_t i = 0; i < n; ++i) {
+            n_nonzero += (a[i] != 0.0);
+            a[i] = i;
+        }
+        EXPECT_EQ(n_nonzero, 0);
+        m_log_h3lpr("huge pages: path = %s, %ld huge pages for %ld bytes", path_name[a_ptr.path()], a_ptr.huge_page_count(), n * sizeof(double));
+        a_ptr.free();
+    }
+}
+
+TEST_F(TestMacros, shared) {
+    int node_rank, node_size;
+    MPI_Comm_rank(NodeComm(), &node_rank);
+    MPI_Comm_size(NodeComm(), &node_size);
+
+    // every rank has a segment of a different size
+    const size_t n = 1000 + 7 * node_rank;
+    m_ptr<H3LPR_ALLOC_MPI_SHARED, double*, ALIGNMENT> a_ptr(n * sizeof(double));
+    double*                                           a = a_ptr();
+    EXPECT_TRUE(m_isaligned(a, ALIGNMENT));
+    for (size_t i = 0; i < n; ++i) {
+        EXPECT_EQ(a[i], 0.0);
+        a[i] = node_rank * 1e+6 + i;
+    }
+    a_ptr.sync();
+
+    // read the segment of the next rank on the node directly
+    const int     next_rank = (node_rank + 1) % node_size;
+    size_t        next_byte;
+    const double* next   = a_ptr.shared(next_rank, &next_byte);
+    const size_t  next_n = 1000 + 7 * next_rank;
+    EXPECT_TRUE(m_isaligned(next, ALIGNMENT));
+    EXPECT_GE(next_byte, next_n * sizeof(double));
+    size_t n_wrong = 0;
+    for (size_t i = 0; i < next_n; ++i) {
+        n_wrong += (next[i] != next_rank * 1e+6 + i);
+    }
+    EXPECT_EQ(n_wrong, 0);
+    a_ptr.free();
+}
+
+TEST_F(TestMacros, window) {
+    int rank, comm_size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+
+    const int n = 1000;
+    m_ptr<H3LPR_ALLOC_MPI_WIN, double*, ALIGNMENT> a_ptr(n * sizeof(double));
+    double*                                        a = a_ptr();
+    EXPECT_TRUE(m_isaligned(a, ALIGNMENT));
+
+    // the window is reused for several exchanges: put in the aligned view of the next rank
+    const int next_rank = (rank + 1) % comm_size;
+    const int prev_rank = (rank - 1 + comm_size) % comm_size;
+    for (int iter = 0; iter < 3; ++iter) {
+        std::vector<double> data(n / 2);
+        for (int i = 0; i < n / 2; ++i) {
+            data[i] = iter * 1e+6 + rank * 1e+3 + i;
+        }
+        MPI_Win_fence(0, a_ptr.win());
+        MPI_Put(data.data(), n / 2, MPI_DOUBLE, next_rank, a_ptr.disp(next_rank, (n / 2) * sizeof(double)), n / 2, MPI_DOUBLE, a_ptr.win());
+        MPI_Win_fence(0, a_ptr.win());
+
+        int n_wrong = 0;
+        for (int i = 0; i < n / 2; ++i) {
+            n_wrong += (a[i] != 0.0);
+            n_wrong += (a[n / 2 + i] != iter * 1e+6 + prev_rank * 1e+3 + i);
+        }
+        EXPECT_EQ(n_wrong, 0);
+    }
+    a_ptr.free();
+}
+
+TEST_F(TestMacros, uptr) {
+    static_assert(!std::is_copy_constructible<m_uptr<H3LPR_ALLOC_POSIX, double*, ALIGNMENT>>::value, "m_uptr cannot be copied");
+    const size_t n = 1000;
+    {
+        m_uptr<H3LPR_ALLOC_POSIX, double*, ALIGNMENT> a_ptr(n * sizeof(double));
+        EXPECT_EQ(a_ptr.size(), n * sizeof(double));
+        for (size_t i = 0; i < n; ++i) {
+            a_ptr()[i] = i;
+        }
+        // the data is kept, the tail is zeroed and the alignment is kept
+        a_ptr.resize(3 * n * sizeof(double));
+        double* a       = a_ptr();
+        size_t  n_wrong = 0;
+        for (size_t i = 0; i < 3 * n; ++i) {
+            n_wrong += (a[i] != ((i < n) ? i : 0.0));
+        }
+        EXPECT_EQ(n_wrong, 0);
+        EXPECT_TRUE(m_isaligned(a, ALIGNMENT));
+
+        // a shrink keeps the memory, growing back zeroes the bytes used before
+        a_ptr.resize(n / 2 * sizeof(double));
+        a_ptr.resize(n * sizeof(double));
+        EXPECT_EQ(a_ptr(), a);
+        for (size_t i = n / 2; i < n; ++i) {
+            n_wrong += (a[i] != 0.0);
+        }
+        EXPECT_EQ(n_wrong, 0);
+
+        // the ownership is moved
+        m_uptr<H3LPR_ALLOC_POSIX, double*, ALIGNMENT> b_ptr = std::move(a_ptr);
+        EXPECT_FALSE(a_ptr.is_alloc());
+        EXPECT_EQ(a_ptr.size(), 0);
+        EXPECT_EQ(b_ptr(), a);
+        EXPECT_EQ(b_ptr.size(), n * sizeof(double));
+    }
+    {
+        // the huge pages are extended in place when possible
+        m_uptr<H3LPR_ALLOC_HUGE, double*, ALIGNMENT> a_ptr(n * sizeof(double), H3LPR_INIT_FIRSTTOUCH);
+        for (size_t i = 0; i < n; ++i) {
+            a_ptr()[i] = i;
+        }
+        const double* a = a_ptr();
+        a_ptr.resize((1 << 20) * sizeof(double));
+        double* b       = a_ptr();
+        size_t  n_wrong = 0;
+        for (size_t i = 0; i < (1 << 20); ++i) {
+            n_wrong += (b[i] != ((i < n) ? i : 0.0));
+        }
+        EXPECT_EQ(n_wrong, 0);
+        EXPECT_TRUE(m_isaligned(b, h3lpr_huge_size));
+        m_log_h3lpr("m_uptr: the huge pages have been %s", (a == b) ? "extended in place" : "copied");
+
+        // growing back within the mapping zeroes the bytes used before, up to the high-water mark
+        a_ptr.resize(n / 2 * sizeof(double));
+        a_ptr.resize(2 * n * sizeof(double));
+        EXPECT_EQ(a_ptr(), b);
+        for (size_t i = n / 2; i < 2 * n; ++i) {
+            n_wrong += (b[i] != 0.0);
+        }
+        EXPECT_EQ(n_wrong, 0);
+    }
+    {
+        // the copy path: a page mapped right after the huge pages prevents the extension in place
+        m_uptr<H3LPR_ALLOC_HUGE, double*, ALIGNMENT> a_ptr(n * sizeof(double));
+        for (size_t i = 0; i < n; ++i) {
+            a_ptr()[i] = i;
+        }
+        const size_t  page    = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        char*         end     = reinterpret_cast<char*>(a_ptr()) + h3lpr_huge_size;
+        void*         blocker = mmap(end, page, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+        const double* a       = a_ptr();
+        a_ptr.resize(2 * h3lpr_huge_size);
+        double* b       = a_ptr();
+        size_t  n_wrong = 0;
+        for (size_t i = 0; i < 2 * h3lpr_huge_size / sizeof(double); ++i) {
+            n_wrong += (b[i] != ((i < n) ? i : 0.0));
+        }
+        EXPECT_EQ(n_wrong, 0);
+        if (blocker != MAP_FAILED) {
+            EXPECT_NE(a, b);
+            munmap(blocker, page);
+        }
+    }
+    {
+        // a pool block grows in place up to the size of its class, a reused block is zeroed
+        const size_t requested = PoolGetStats().byte_requested;
+        for (int iter = 0; iter < 2; ++iter) {
+            m_uptr<H3LPR_ALLOC_POOL, double*, ALIGNMENT> a_ptr(100 * sizeof(double));
+            double*                                      a       = a_ptr();
+            size_t                                       n_wrong = 0;
+            for (size_t i = 0; i < 100; ++i) {
+                n_wrong += (a[i] != 0.0);
+                a[i] = 1.0;
+            }
+            a_ptr.resize(50 * sizeof(double));
+            a_ptr.resize(128 * sizeof(double));
+            EXPECT_EQ(a_ptr(), a);
+            for (size_t i = 50; i < 128; ++i) {
+                n_wrong += (a[i] != 0.0);
+                a[i] = 1.0;
+            }
+            EXPECT_EQ(n_wrong, 0);
+            EXPECT_EQ(PoolGetStats().byte_requested, requested + 128 * sizeof(double));
+        }
+        EXPECT_EQ(PoolGetStats().byte_requested, requested);
+    }
+}
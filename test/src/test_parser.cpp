@@ -1,3 +1,6 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+
 #include "gtest/gtest.h"
 #include "macros.hpp"
 #include "parser.hpp"
@@ -89,4 +92,298 @@ TEST_F(TestParser, file) {
     EXPECT_EQ(is_flag, true);
 
     parser.Finalize();
-}
\ No newline at end of file
+}
+
+TEST_F(TestParser, file_include) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    // only the master reads the files, the other ranks get the content by broadcast
+    if (rank == 0) {
+        std::ofstream main_fs("prof/config_main");
+        main_fs << "--param1=3 # a comment\n--config=config_included\n--flag2\n";
+        main_fs.close();
+        std::ofstream inc_fs("prof/config_included");
+        inc_fs << "--param2=1.5 --param3=included\n";
+        inc_fs.close();
+    }
+    const int   argc   = 2;
+    const char* msg[2] = {"./h3lpr", "--config=prof/config_main"};
+
+    // create the parser
+    Parser parser(argc, msg);
+
+    EXPECT_EQ(parser.GetValue<int>("--param1", "param from the main file"), 3);
+    EXPECT_EQ(parser.GetValue<double>("--param2", "param from the included file"), 1.5);
+    EXPECT_EQ(parser.GetValue<string>("--param3", "param from the included file"), "included");
+    EXPECT_EQ(parser.TestFlag("--flag2"), true);
+
+    parser.Finalize();
+}
+
+TEST_F(TestParser, cache) {
+    const int   argc   = 5;
+    const char* msg[5] = {"./h3lpr", "--int=+42", "--double=1e-3", "--array=1,2", "--string=hello"};
+
+    // create the parser
+    Parser parser(argc, msg);
+
+    // repeated requests return the same values
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(parser.GetValue<int>("--int", "an integer"), 42);
+        EXPECT_EQ(parser.GetValue<double>("--double", "a double"), 1e-3);
+        EXPECT_EQ(parser.GetValue<string>("--string", "a string"), "hello");
+        auto array = parser.GetValues<int, 2>("--array", "an array");
+        EXPECT_EQ(array[0], 1);
+        EXPECT_EQ(array[1], 2);
+    }
+    // the same key with another type is converted again
+    EXPECT_EQ(parser.GetValue<long>("--int", "an integer"), 42l);
+    EXPECT_EQ(parser.GetValue<float>("--double", "a double"), 1e-3f);
+    // the default value is not cached if it changes
+    EXPECT_EQ(parser.GetValue<int>("--missing", "a missing value", 1), 1);
+    EXPECT_EQ(parser.GetValue<int>("--missing", "a missing value", 1), 1);
+    EXPECT_EQ(parser.GetValue<int>("--missing", "a missing value", 2), 2);
+
+    // conversions
+    EXPECT_EQ(convertTypeToStr(0.1), "0.1");
+    EXPECT_EQ(convertTypeToStr(-17), "-17");
+    EXPECT_EQ(convertStrToType<double>(convertTypeToStr(1.0 / 3.0)), 1.0 / 3.0);
+#ifdef NDEBUG
+    // without the assert, an invalid number gives its longest valid prefix or 0
+    EXPECT_EQ(convertStrToType<int>("1.5"), 1);
+    EXPECT_EQ(convertStrToType<int>("abc"), 0);
+    std::vector<int> list;
+    convertStrToVector<int>("abc,2", "abc,2" + 5, &list);
+    EXPECT_EQ(list, std::vector<int>({0, 2}));
+#endif
+
+    parser.Finalize();
+
+    // a required argument is reported as missing even if its default value has been cached
+    for (int i = 0; i < 3; ++i) {
+        const char* msg_missing[1] = {"./h3lpr"};
+        Parser      parser_missing(1, msg_missing);
+        if (i == 0) {
+            parser_missing.GetValue<int>("--n", "the n", 0);
+            parser_missing.GetValue<int>("--n", "the n");
+        } else if (i == 1) {
+            parser_missing.GetValues<int, 2>("--n", "the n", {0, 0});
+            parser_missing.GetValues<int, 2>("--n", "the n");
+        } else {
+            parser_missing.GetVector<int>("--n", "the n", {});
+            parser_missing.GetVector<int>("--n", "the n");
+        }
+        EXPECT_TRUE(parser_missing.TestFlag("--error"));
+    }
+}
+
+TEST_F(TestParser, vector) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    // the rank 0 reads the file, it must be written first
+    const int n_file = 100000;
+    if (rank == 0) {
+        std::ofstream file_fs("prof/vector_values");
+        for (int i = 0; i < n_file; ++i) {
+            file_fs << 0.5 * i << ((i % 10 == 9) ? "\n" : ", ");
+        }
+        file_fs.close();
+        // the file is relative to the configuration file
+        std::ofstream config_fs("prof/config_vector");
+        config_fs << "--relative=@vector_values\n";
+        config_fs.close();
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    const int   argc   = 4;
+    const char* msg[4] = {"./h3lpr", "--list=1,2 3,  4,+5", "--file=@prof/vector_values", "--config=prof/config_vector"};
+
+    // create the parser
+    Parser parser(argc, msg);
+
+    std::vector<int> list = parser.GetVector<int>("--list", "a list of any length");
+    ASSERT_EQ(list.size(), 5);
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_EQ(list[i], i + 1);
+    }
+
+    std::vector<double> file = parser.GetVector<double>("--file", "a list read from a file");
+    ASSERT_EQ(file.size(), n_file);
+    for (int i = 0; i < n_file; ++i) {
+        EXPECT_EQ(file[i], 0.5 * i);
+    }
+
+    std::vector<double> relative = parser.GetVector<double>("--relative", "a list read from a file relative to the configuration");
+    EXPECT_EQ(relative, file);
+
+    std::vector<double> def = parser.GetVector<double>("--default", "a default list", {0.1, 0.2});
+    ASSERT_EQ(def.size(), 2);
+    EXPECT_EQ(def[1], 0.2);
+
+    parser.Finalize();
+}
+
+TEST_F(TestParser, section) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rank == 0) {
+        std::ofstream main_fs("prof/config_section");
+        main_fs << "--level=2\n[solver]\n--tol=1e-6\n--verbose\n[solver.rhs]\n--order=4\n[]\n--name=main\n";
+        main_fs.close();
+    }
+    const int   argc   = 4;
+    const char* msg[4] = {"./h3lpr", "--config=prof/config_section", "--solver.lhs.order=2", "--help"};
+
+    // create the parser
+    Parser parser(argc, msg);
+
+    EXPECT_EQ(parser.GetValue<int>("--level", "a global param"), 2);
+    EXPECT_EQ(parser.GetValue<string>("--name", "a global param after the sections"), "main");
+    EXPECT_EQ(parser.GetValue<double>("--solver.tol", "the full key"), 1e-6);
+
+    // the view on the section and the subsections
+    ParserView solver = parser.Section("solver");
+    EXPECT_EQ(solver.GetValue<double>("--tol", "the tolerance"), 1e-6);
+    EXPECT_EQ(solver.GetFlag("--verbose", "verbose solver"), true);
+    EXPECT_EQ(solver.Section("rhs").GetValue<int>("--order", "the rhs order"), 4);
+    EXPECT_EQ(solver.Section("lhs").GetValue<int>("--order", "the lhs order"), 2);
+    EXPECT_EQ(solver.Section("lhs").GetValue<int>("--width", "the lhs width", 3), 3);
+
+    parser.Finalize();
+}
+
+/**
+ * @brief a kernel templated on its block size
+ */
+template <int BS>
+static int BlockKernel(const int n) {
+    static_assert(BS % 4 == 0, "the block size must be a multiple of 4");
+    return n * BS;
+}
+
+TEST_F(TestParser, dispatch) {
+    {
+        const int   argc   = 3;
+        const char* msg[3] = {"./h3lpr", "--bs=16", "--solver.order=2"};
+        Parser      parser(argc, msg);
+
+        int result = Dispatch<4, 8, 16, 32>(&parser, "--bs", "the block size", [](auto BS) { return BlockKernel<BS>(2); });
+        EXPECT_EQ(result, 32);
+        // default value
+        result = Dispatch<4, 8>(&parser, "--bs-default", "the block size", 8, [](auto BS) { return BlockKernel<BS>(1); });
+        EXPECT_EQ(result, 8);
+        // through a view, with a void function
+        ParserView view  = parser.Section("solver");
+        int        order = 0;
+        Dispatch<1, 2, 4>(&view, "--order", "the order", [&order](auto ORDER) { order = ORDER; });
+        EXPECT_EQ(order, 2);
+        EXPECT_FALSE(parser.TestFlag("--error"));
+        parser.Finalize();
+        // a supported value can still be dispatched after the Finalize call (an unsupported one aborts)
+        EXPECT_TRUE(parser.is_finalized());
+        result = Dispatch<4, 8, 16, 32>(&parser, "--bs", "the block size", [](auto BS) { return BlockKernel<BS>(1); });
+        EXPECT_EQ(result, 16);
+    }
+    {
+        const int   argc   = 2;
+        const char* msg[2] = {"./h3lpr", "--bs=12"};
+        Parser      parser(argc, msg);
+
+        // an unsupported value falls back on the first one and forces the failure in Finalize
+        int result = Dispatch<4, 8, 16, 32>(&parser, "--bs", "the block size", [](auto BS) { return BlockKernel<BS>(1); });
+        EXPECT_EQ(result, 4);
+        EXPECT_TRUE(parser.TestFlag("--error"));
+    }
+}
+
+TEST_F(TestParser, override) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    const int   argc   = 8;
+    const char* msg[8] = {"./h3lpr", "--weight=1.0", "--weight@rank%2==1=1.5", "--weight@rank[0,5]=0.5",
+                          "--threads=4", "--threads@node[0]=8", "--only@rank[1]=3", "--debug@rank%2==0"};
+
+    // create the parser
+    Parser parser(argc, msg);
+
+    // the rank overrides come first, then the node ones
+    // on the rank 5, rank[0,5] matches fewer ranks than rank%2==1 and wins
+    const double weight = parser.GetValue<double>("--weight", "the weight of the rank");
+    EXPECT_EQ(weight, (rank == 0 || rank == 5) ? 0.5 : ((rank % 2 == 1) ? 1.5 : 1.0));
+    const int threads = parser.GetValue<int>("--threads", "the number of threads");
+    EXPECT_EQ(threads, (NodeId() == 0) ? 8 : 4);
+    // an override without global value
+    EXPECT_EQ(parser.HasArg("--only"), rank == 1);
+    EXPECT_FALSE(parser.HasArg("--only@rank[1]"));
+    // a flag with a selector
+    EXPECT_EQ(parser.GetFlag("--debug", "a flag given to some ranks"), rank % 2 == 0);
+    EXPECT_FALSE(parser.TestFlag("--error"));
+
+    parser.Finalize();
+
+    // two overrides as specific as each other do not conflict if a more specific one wins
+    int comm_size;
+    MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+    if (comm_size >= 2) {
+        const char* msg_tie[6] = {"./h3lpr", "--w=0", "--w@rank[0-1]=1", "--w@rank[0,1]=2", "--w@rank[0]=3", "--w@rank[1]=4"};
+        Parser      parser_tie(6, msg_tie);
+        EXPECT_EQ(parser_tie.GetValue<int>("--w", "the w"), (rank < 2) ? (3 + rank) : 0);
+        EXPECT_FALSE(parser_tie.TestFlag("--error"));
+        parser_tie.Finalize();
+    }
+}
+
+TEST_F(TestParser, reload) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rank == 0) {
+        std::ofstream main_fs("prof/config_reload");
+        main_fs << "--freq=10\n--fixed=1\n--verbose\n";
+        main_fs.close();
+    }
+    const int   argc   = 3;
+    const char* msg[3] = {"./h3lpr", "--config=prof/config_reload", "--cmd=5"};
+    Parser      parser(argc, msg);
+    parser.MarkReloadable("--freq");
+    parser.MarkReloadable("--verbose");
+    parser.MarkReloadable("--cmd");
+
+    EXPECT_EQ(parser.GetValue<int>("--freq", "a reloadable param"), 10);
+    EXPECT_EQ(parser.GetValue<int>("--fixed", "a fixed param"), 1);
+    EXPECT_TRUE(parser.GetFlag("--verbose", "a reloadable flag"));
+    // nothing has changed
+    EXPECT_FALSE(parser.Sync());
+
+    // change the file, with a modification time in the future to be sure to detect it
+    if (rank == 0) {
+        std::ofstream main_fs("prof/config_reload");
+        main_fs << "--freq=20\n--fixed=2\n--cmd=6\n";
+        main_fs.close();
+        struct timespec times[2];
+        clock_gettime(CLOCK_REALTIME, times + 0);
+        times[0].tv_sec += 10;
+        times[1] = times[0];
+        utimensat(AT_FDCWD, "prof/config_reload", times, 0);
+    }
+    EXPECT_TRUE(parser.Sync());
+    EXPECT_EQ(parser.GetValue<int>("--freq", "a reloadable param"), 20);
+    EXPECT_EQ(parser.GetValue<int>("--fixed", "a fixed param"), 1);
+    EXPECT_FALSE(parser.GetFlag("--verbose", "a reloadable flag"));
+    // the command line is not affected
+    EXPECT_EQ(parser.GetValue<int>("--cmd", "a command line param"), 5);
+    EXPECT_FALSE(parser.Sync());
+
+    // a file that cannot be read is ignored, the values are kept until it comes back
+    if (rank == 0) {
+        rename("prof/config_reload", "prof/config_reload_moved");
+    }
+    EXPECT_FALSE(parser.Sync());
+    EXPECT_EQ(parser.GetValue<int>("--freq", "a reloadable param"), 20);
+    if (rank == 0) {
+        rename("prof/config_reload_moved", "prof/config_reload");
+    }
+    EXPECT_FALSE(parser.Sync());
+    EXPECT_EQ(parser.GetValue<int>("--freq", "a reloadable param"), 20);
+
+    parser.Finalize();
+}
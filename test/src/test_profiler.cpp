@@ -1,4 +1,9 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 #include "gtest/gtest.h"
+#include "instrument.hpp"
 #include "profiler.hpp"
 #include "ptr.hpp"
 
@@ -167,6 +172,7 @@ TEST_F(TestProf, prof) {
 
     m_profDisp(&prof);
 }
+#undef size
 
 TEST_F(TestProf, display) {
     Profiler prof("display");
@@ -186,4 +192,374 @@ TEST_F(TestProf, display) {
     m_profStop(&prof, "level 1");
     m_log_h3lpr("Displaying Profiler from top level.");
     m_profDisp(&prof);
-}
\ No newline at end of file
+}
+
+TEST_F(TestProf, dump_raw) {
+    Profiler prof("dump");
+
+    m_profStart(&prof, "level 1");
+    m_profStart(&prof, "level 2");
+    m_profStop(&prof, "level 2");
+    m_profStop(&prof, "level 1");
+    m_profDumpRaw(&prof);
+
+    int rank, comm_size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+    if (rank == 0) {
+        FILE* file = fopen("./prof/dump_raw.bin", "r");
+        ASSERT_NE(file, nullptr);
+        char    magic[8];
+        int32_t info[4];
+        fread(magic, sizeof(char), 8, file);
+        fread(info, sizeof(int32_t), 4, file);
+        EXPECT_EQ(strncmp(magic, "H3LPRRAW", 8), 0);
+        EXPECT_EQ(info[1], comm_size);
+        EXPECT_EQ(info[2], 3);  // root + 2 levels
+        EXPECT_EQ(info[3], static_cast<int32_t>(TimerBlock::RawFields().size()));
+        fclose(file);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    // every rank reads back its own record and compares it to the profiler
+    FILE* file = fopen("./prof/dump_raw.bin", "r");
+    ASSERT_NE(file, nullptr);
+    char    magic[8];
+    int32_t info[4];
+    fread(magic, sizeof(char), 8, file);
+    fread(info, sizeof(int32_t), 4, file);
+    const int32_t nblock = info[2];
+    const int32_t nfield = info[3];
+
+    auto read_str = [file]() {
+        int32_t len;
+        fread(&len, sizeof(int32_t), 1, file);
+        std::string str(len, '\0');
+        fread(&str[0], sizeof(char), len, file);
+        return str;
+    };
+    std::vector<std::string> fields(nfield);
+    std::vector<std::string> paths(nblock);
+    for (auto& field : fields) {
+        field = read_str();
+    }
+    for (auto& path : paths) {
+        path = read_str();
+    }
+    const long          header_size = (ftell(file) + sizeof(double) - 1) / sizeof(double) * sizeof(double);
+    std::vector<double> data(static_cast<size_t>(nblock) * nfield);
+    fseek(file, header_size + static_cast<long>(rank) * data.size() * sizeof(double), SEEK_SET);
+    ASSERT_EQ(fread(data.data(), sizeof(double), data.size(), file), data.size());
+    fclose(file);
+
+    EXPECT_EQ(fields, TimerBlock::RawFields());
+    EXPECT_EQ(paths[1], "root/level 1");
+    EXPECT_EQ(paths[2], "root/level 1/level 2");
+    for (int32_t ib = 1; ib < nblock; ++ib) {
+        EXPECT_EQ(data[ib * nfield + 0], prof.GetTime(paths[ib]));
+        EXPECT_EQ(data[ib * nfield + 1], prof.GetCount(paths[ib]));
+        EXPECT_EQ(data[ib * nfield + 2], prof.GetMemsize(paths[ib]));
+    }
+}
+
+TEST_F(TestProf, shm) {
+    Profiler prof("shm");
+    m_profStart(&prof, "level 1");
+    m_profStop(&prof, "level 1");
+    prof.EnableShm();
+    m_profStart(&prof, "level 1");
+    m_profStart(&prof, "level 2");
+
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    const std::string name = "/h3lpr.shm." + std::to_string(rank);
+
+    // attach as an external reader would do
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    ASSERT_GE(fd, 0);
+    void* addr = mmap(nullptr, sizeof(ShmLayout), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    ASSERT_NE(addr, MAP_FAILED);
+
+    std::vector<ShmLayout> snap(1);
+    ASSERT_TRUE(ShmSnapshot(reinterpret_cast<const ShmLayout*>(addr), snap.data()));
+    EXPECT_EQ(snap[0].header.nblock, 3);
+    EXPECT_EQ(snap[0].header.current, 2);
+    EXPECT_STREQ(snap[0].block[2].path, "root/level 1/level 2");
+    EXPECT_EQ(snap[0].block[1].count, 1.0);
+    EXPECT_EQ(snap[0].block[2].running, 1);
+    munmap(addr, sizeof(ShmLayout));
+
+    m_profStop(&prof, "level 2");
+    m_profStop(&prof, "level 1");
+}
+
+TEST_F(TestProf, path) {
+    Profiler prof("path");
+
+    m_profStart(&prof, "step");
+    m_profStart(&prof, "rhs");
+    m_profStart(&prof, "stencil");
+    m_profStop(&prof, "stencil");
+    m_profStart(&prof, "stencil");
+    m_profStop(&prof, "stencil");
+    m_profStop(&prof, "rhs");
+    m_profStop(&prof, "step");
+
+    // from the root, any block can be accessed using its path
+    EXPECT_TRUE(prof.HasBlock("root/step/rhs/stencil"));
+    EXPECT_FALSE(prof.HasBlock("root/step/stencil"));
+    EXPECT_EQ(prof.GetCount("root/step/rhs/stencil"), 2);
+    EXPECT_EQ(prof.GetCount("step"), 1);
+    EXPECT_GE(prof.GetTime("root/step"), prof.GetTime("root/step/rhs"));
+
+    // the reduced time is at least the local one
+    const double tmax = prof.GetTimeReduced("root/step/rhs/stencil", MPI_MAX);
+    EXPECT_GE(tmax, prof.GetTime("root/step/rhs/stencil"));
+}
+
+TEST_F(TestProf, cost) {
+    Profiler prof("cost");
+
+    int rank, comm_size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+
+    m_profStart(&prof, "step");
+    m_profStop(&prof, "step");
+    EXPECT_GE(prof.GetCost("root/step"), 0.0);
+
+    // after a reset the cost is 0 while the time is unchanged
+    const double time = prof.GetTime("root/step");
+    prof.ResetCost("root/step");
+    EXPECT_EQ(prof.GetCost("root/step"), 0.0);
+    EXPECT_EQ(prof.GetTime("root/step"), time);
+
+    // the running time is accounted for
+    m_profStart(&prof, "step");
+    double x = 0.0;
+    for (int i = 0; i < 1729; ++i) {
+        x += (i % 2) ? sin(2.0 * i) : cos(2.0 * i);
+    }
+    EXPECT_GT(prof.GetCost("root/step"), 0.0);
+    m_profStop(&prof, "step");
+
+    const std::vector<double>& cost = prof.GatherCost("root/step");
+    ASSERT_EQ(static_cast<int>(cost.size()), comm_size);
+    EXPECT_EQ(cost[rank], prof.GetCost("root/step"));
+}
+
+TEST_F(TestProf, trace) {
+    Profiler prof("trace");
+
+    int rank, comm_size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+
+    prof.EnableTrace(16);
+    prof.SyncClock();
+    for (int it = 0; it < 4; ++it) {
+        m_profStart(&prof, "step");
+        m_profStop(&prof, "step");
+    }
+    prof.SyncClock();
+
+    // MPI_Wtime may start at the launch of each process, the offset is not small: check the causality instead
+    // a time sent by rank 0 is received later, up to the error on the offset
+    double t_send = MPI_Wtime();
+    MPI_Bcast(&t_send, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    EXPECT_GE(prof.GlobalTime(MPI_Wtime()), t_send - 1e-2);
+    const double wtime = MPI_Wtime();
+    // the samples are too close to fit a drift, the offset is constant
+    EXPECT_NEAR(prof.GlobalTime(wtime + 100.0) - (wtime + 100.0), prof.GlobalTime(wtime) - wtime, 1e-9);
+    if (rank == 0) {
+        EXPECT_EQ(prof.GlobalTime(wtime), wtime);
+    }
+
+    prof.DumpTrace();
+    if (rank == 0) {
+        FILE* file = fopen("./prof/trace_trace.csv", "r");
+        ASSERT_NE(file, nullptr);
+        int  n_line = 0;
+        char line[256];
+        while (fgets(line, 256, file) != nullptr) {
+            n_line += 1;
+        }
+        EXPECT_EQ(n_line, 1 + 4 * comm_size);
+        fclose(file);
+    }
+}
+
+TEST_F(TestProf, resource) {
+    Profiler prof("resource");
+    prof.EnableResource();
+
+    // the first touch of every page of a fresh mapping generates a minor page fault
+    const size_t page   = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t n_page = 1024;
+    char*        a      = reinterpret_cast<char*>(mmap(nullptr, n_page * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    ASSERT_NE(a, MAP_FAILED);
+    madvise(a, n_page * page, MADV_NOHUGEPAGE);
+    m_profStart(&prof, "first touch");
+    for (size_t ip = 0; ip < n_page; ++ip) {
+        a[ip * page] = 1;
+    }
+    m_profStop(&prof, "first touch");
+    munmap(a, n_page * page);
+
+    // writing a file increases the written bytes
+    const size_t      n_write = 1 << 20;
+    const std::string fname   = "./prof/resource_" + std::to_string(getpid()) + ".bin";
+    std::vector<char> data(n_write, 'a');
+    m_profStart(&prof, "write");
+    FILE* file = fopen(fname.c_str(), "w");
+    ASSERT_NE(file, nullptr);
+    fwrite(data.data(), sizeof(char), n_write, file);
+    fclose(file);
+    m_profStop(&prof, "write");
+    remove(fname.c_str());
+
+    double res[H3LPR_RES_N];
+    SampleResource(res);
+    EXPECT_GT(res[H3LPR_RES_RSS], 0.0);
+    EXPECT_GE(prof.GetResource("first touch", H3LPR_RES_MINFLT), n_page);
+    if (res[H3LPR_RES_WRITE] > 0.0) {
+        EXPECT_GE(prof.GetResource("write", H3LPR_RES_WRITE), n_write);
+    }
+    m_profDisp(&prof);
+}
+
+TEST_F(TestProf, save_load) {
+    Profiler prof_0("save");
+    for (int it = 0; it < 2; ++it) {
+        m_profStart(&prof_0, "step");
+        m_profStart(&prof_0, "substep");
+        m_profStop(&prof_0, "substep");
+        m_profStop(&prof_0, "step");
+    }
+    prof_0.Save("./prof/save_load.bin");
+
+    // the restarted profiler continues the tree
+    Profiler prof_1("load");
+    prof_1.Load("./prof/save_load.bin");
+    EXPECT_EQ(prof_1.GetCount("root/step"), 2);
+    EXPECT_EQ(prof_1.GetCount("root/step/substep"), 2);
+    EXPECT_EQ(prof_1.GetTime("root/step"), prof_0.GetTime("root/step"));
+    // the cost only measures the current run
+    EXPECT_EQ(prof_1.GetCost("root/step"), 0.0);
+
+    m_profStart(&prof_1, "step");
+    m_profStop(&prof_1, "step");
+    EXPECT_EQ(prof_1.GetCount("root/step"), 3);
+    EXPECT_LT(prof_1.GetCost("root/step"), prof_1.GetTime("root/step"));
+
+    // a foreign file is ignored
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rank == 0) {
+        FILE* file = fopen("./prof/save_load_foreign.bin", "w");
+        ASSERT_NE(file, nullptr);
+        fprintf(file, "not a profiler file");
+        fclose(file);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    prof_1.Load("./prof/save_load_foreign.bin");
+    EXPECT_EQ(prof_1.GetCount("root/step"), 3);
+    m_profDisp(&prof_1);
+}
+
+int ScopedWork(Profiler* prof, const int i) {
+    m_profScope(prof, "work");
+    if (i % 2) {
+        // early return
+        return i;
+    }
+    if (i % 3 == 0) {
+        throw i;
+    }
+    return 0;
+}
+
+TEST_F(TestProf, scope) {
+    Profiler prof("scope");
+
+    {
+        m_profScope(&prof, "outer");
+        for (int i = 0; i < 10; ++i) {
+            try {
+                ScopedWork(&prof, i);
+            } catch (int) {
+            }
+        }
+    }
+    // the same site reached from another parent and another profiler
+    m_profStart(&prof, "other");
+    ScopedWork(&prof, 1);
+    m_profStop(&prof, "other");
+
+    Profiler prof_2("scope 2");
+    ScopedWork(&prof_2, 1);
+
+    EXPECT_EQ(prof.GetCount("root/outer"), 1);
+    EXPECT_EQ(prof.GetCount("root/outer/work"), 10);
+    EXPECT_EQ(prof.GetCount("root/other/work"), 1);
+    EXPECT_EQ(prof_2.GetCount("root/work"), 1);
+
+    // a disabled timer has no state
+    EXPECT_TRUE(std::is_empty<ScopedTimer<false>>::value);
+}
+
+#if (M_INSTRUMENT_PROF)
+#include <cxxabi.h>
+#include <dlfcn.h>
+
+extern "C" {
+void __cyg_profile_func_enter(void* fn, void* call_site);
+void __cyg_profile_func_exit(void* fn, void* call_site);
+}
+
+TEST_F(TestProf, instrument) {
+    Profiler prof("instrument");
+
+    // mimic the calls generated by -finstrument-functions
+    void* fn_work = reinterpret_cast<void*>(&ScopedWork);
+    void* fn_test = reinterpret_cast<void*>(&MPI_Wtime);
+
+    // the name is the demangled symbol if dladdr resolves it (link with -rdynamic), the address otherwise
+    std::string name_work;
+    Dl_info     info;
+    if (dladdr(fn_work, &info) != 0 && info.dli_sname != nullptr) {
+        int   status;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        name_work       = (status == 0) ? std::string(demangled) : std::string(info.dli_sname);
+        std::free(demangled);
+    } else {
+        char addr[32];
+        snprintf(addr, 32, "%p", fn_work);
+        name_work = addr;
+        m_log_h3lpr("WARNING: the test is not linked with -rdynamic, the functions are recorded by address");
+    }
+
+    m_profStart(&prof, "manual");
+    InstrumentStart(&prof, {name_work, "MPI_Wtime"}, {"MPI_"});
+    for (int i = 0; i < 3; ++i) {
+        __cyg_profile_func_enter(fn_work, nullptr);
+        __cyg_profile_func_enter(fn_test, nullptr);
+        __cyg_profile_func_exit(fn_test, nullptr);
+        __cyg_profile_func_exit(fn_work, nullptr);
+    }
+    InstrumentStop();
+
+    // the filtered functions do not count in the depth
+    InstrumentStart(&prof, {name_work}, {"MPI_"}, 1);
+    __cyg_profile_func_enter(fn_test, nullptr);
+    __cyg_profile_func_enter(fn_work, nullptr);
+    __cyg_profile_func_exit(fn_work, nullptr);
+    __cyg_profile_func_exit(fn_test, nullptr);
+    InstrumentStop();
+    m_profStop(&prof, "manual");
+
+    EXPECT_EQ(prof.GetCount("root/manual/" + name_work), 4);
+    EXPECT_FALSE(prof.HasBlock("root/manual/" + name_work + "/MPI_Wtime"));
+}
+#endif
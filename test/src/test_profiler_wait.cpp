@@ -0,0 +1,55 @@
+// this file is compiled with the wait decomposition of the synchronizing blocks, see m_profStartSync
+#define WAIT_PROF
+
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#include "profiler.hpp"
+
+using namespace H3LPR;
+
+class TestProfWait : public ::testing::Test {
+    void SetUp() override {
+        const testing::TestInfo* const test_info = testing::UnitTest::GetInstance()->current_test_info();
+        m_log_noheader("::group:: Testing %s/%s", test_info->test_suite_name(), test_info->name());
+    };
+    void TearDown() override {
+        m_log_noheader("::endgroup::");
+    };
+};
+
+TEST_F(TestProfWait, wait) {
+    static_assert(M_WAIT_PROF, "the test must be compiled with WAIT_PROF");
+    Profiler prof("wait");
+
+    int rank, comm_size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+
+    const int    n_iter = 3;
+    const double late   = 0.05;
+    for (int it = 0; it < n_iter; ++it) {
+        // rank 0 is late
+        m_profStart(&prof, "imbalance");
+        if (rank == 0) {
+            usleep(static_cast<useconds_t>(late * 1e6));
+        }
+        m_profStop(&prof, "imbalance");
+
+        // the collective is split between the wait and the reduction
+        m_profStartSync(&prof, "reduce", MPI_COMM_WORLD);
+        double x = rank, y = 0.0;
+        MPI_Allreduce(&x, &y, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        m_profStop(&prof, "reduce");
+    }
+
+    // only the synchronizing block waits, the wait is included in its time
+    EXPECT_EQ(prof.GetWait("imbalance"), 0.0);
+    EXPECT_GE(prof.GetWait("reduce"), 0.0);
+    EXPECT_LE(prof.GetWait("reduce"), prof.GetTime("reduce"));
+    // the other ranks wait for rank 0 at the entry of the block
+    if (rank != 0) {
+        EXPECT_GE(prof.GetWait("reduce"), 0.5 * n_iter * late);
+    }
+    m_profDisp(&prof);
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) Massachusetts Institute of Technology
+ *
+ * See LICENSE in top-level directory
+ */
+
+/**
+ * @brief live monitoring of a running Profiler, see Profiler::EnableShm
+ *
+ * usage:
+ *      h3lpr-top                           lists the available segments
+ *      h3lpr-top <segment> [period] [--once]
+ *
+ * where segment is /h3lpr.<name>.<rank> and period is the refresh period in seconds (default 2.0).
+ * For each block we display the accumulated time and count, together with the rates measured over the last period.
+ * No MPI call is done, neither here nor in the monitored application.
+ */
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "profiler_shm.hpp"
+
+using namespace H3LPR;
+using std::string;
+
+/**
+ * @brief lists the segments available in /dev/shm
+ */
+static int ListSegments() {
+    DIR* dir = opendir("/dev/shm");
+    if (dir == nullptr) {
+        fprintf(stderr, "unable to open /dev/shm\n");
+        return 1;
+    }
+    printf("available segments:\n");
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (std::strncmp(entry->d_name, "h3lpr.", 6) == 0) {
+            printf("\t/%s\n", entry->d_name);
+        }
+    }
+    closedir(dir);
+    return 0;
+}
+
+/**
+ * @brief a copy of the segment, together with the (monotonic) time at which it has been taken by the reader
+ *
+ * The rates are computed with the reader times: the writer only updates the segment at the start and stop of the blocks,
+ * its time stays the same if the application hangs inside a block.
+ */
+struct Snapshot {
+    ShmLayout layout;
+    double    t_read;
+};
+
+/**
+ * @brief returns the time accumulated by a block at the time of the snapshot, including the running part
+ */
+static double SnapTime(const ShmBlock* block, const double t_read) {
+    double time_acc = block->time_acc;
+    if (block->running && block->t0_mono > 0.0) {
+        time_acc += t_read - block->t0_mono;
+    }
+    return time_acc;
+}
+
+/**
+ * @brief displays the snapshot, with the rates computed from the previous one if any
+ */
+static void Display(const Snapshot* snap, const Snapshot* prev) {
+    const ShmHeader* head = &snap->layout.header;
+    const double     now  = snap->t_read;
+    const double     dt   = (prev != nullptr) ? (now - prev->t_read) : 0.0;
+
+    printf("=========================================================================================================\n");
+    printf("  rank %d (pid %d) - running for %.1f [s] - last update %.2f [s] ago\n", head->rank, head->pid, now - head->t_created, now - head->t_mono);
+
+    // the path of the current block is the current stack
+    if (head->current >= 0 && head->current < head->nblock) {
+        const ShmBlock* current = snap->layout.block + head->current;
+        if (current->running && current->t0_mono > 0.0) {
+            printf("  current stack: %s (running for %.3f [s])\n", current->path, now - current->t0_mono);
+        } else {
+            printf("  current stack: %s\n", current->path);
+        }
+    }
+    printf("---------------------------------------------------------------------------------------------------------\n");
+    printf("%-60s %12s %12s %10s %12s\n", "block", "time [s]", "count", "busy [%]", "calls [1/s]");
+    for (int id = 0; id < head->nblock; ++id) {
+        const ShmBlock* block = snap->layout.block + id;
+        // add the time spent in the running blocks
+        const double time_acc = SnapTime(block, now);
+        if (prev != nullptr && dt > 0.0 && id < prev->layout.header.nblock) {
+            const ShmBlock* pblock    = prev->layout.block + id;
+            const double    ptime_acc = SnapTime(pblock, prev->t_read);
+            const double    busy      = 100.0 * (time_acc - ptime_acc) / dt;
+            const double calls = (block->count - pblock->count) / dt;
+            printf("%-60.60s %12.4f %12.0f %10.2f %12.2f %s\n", block->path, time_acc, block->count, busy, calls, (block->running) ? "*" : "");
+        } else {
+            printf("%-60.60s %12.4f %12.0f %10s %12s %s\n", block->path, time_acc, block->count, "-", "-", (block->running) ? "*" : "");
+        }
+    }
+    printf("=========================================================================================================\n");
+    fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        return ListSegments();
+    }
+    const string name   = argv[1];
+    double       period = 2.0;
+    bool         once   = false;
+    for (int ia = 2; ia < argc; ++ia) {
+        if (std::strcmp(argv[ia], "--once") == 0) {
+            once = true;
+        } else {
+            period = std::atof(argv[ia]);
+        }
+    }
+
+    // attach to the segment
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        fprintf(stderr, "unable to open the segment <%s>\n", name.c_str());
+        return 1;
+    }
+    void* addr = mmap(nullptr, sizeof(ShmLayout), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        fprintf(stderr, "unable to map the segment <%s>\n", name.c_str());
+        return 1;
+    }
+    const ShmLayout* layout = reinterpret_cast<const ShmLayout*>(addr);
+
+    // the layout is big, keep the snapshots on the heap
+    std::vector<Snapshot> snap(2);
+    int                   icurr    = 0;
+    bool                  has_prev = false;
+    while (true) {
+        if (ShmSnapshot(layout, &snap[icurr].layout)) {
+            snap[icurr].t_read = ShmMonoTime();
+            if (snap[icurr].layout.header.version != shm_version) {
+                fprintf(stderr, "version mismatch: %d vs %d\n", snap[icurr].layout.header.version, shm_version);
+                break;
+            }
+            Display(&snap[icurr], (has_prev) ? &snap[1 - icurr] : nullptr);
+            has_prev = true;
+            icurr    = 1 - icurr;
+        }
+        if (once) {
+            break;
+        }
+        usleep(static_cast<useconds_t>(period * 1e6));
+    }
+    munmap(addr, sizeof(ShmLayout));
+    return 0;
+}